@@ -0,0 +1,214 @@
+#include "allocation_profiler.h"
+#include "callstack_capturer.h"
+#include "murmur_hash.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace bowtie
+{
+
+namespace internal
+{
+
+const uint32 profiler_initial_sites = 256;
+const uint32 profiler_empty_lookup = (uint32)-1;
+
+uint32 profiler_lookup_size(const AllocationProfiler* p)
+{
+    return p->sites_capacity * 2;
+}
+
+uint32 find_or_add_site_lookup(AllocationProfiler* p, uint64 hash)
+{
+    auto mask = profiler_lookup_size(p) - 1;
+    auto i = uint32(hash) & mask;
+
+    while (p->site_lookup[i] != profiler_empty_lookup && p->sites[p->site_lookup[i]].hash != hash)
+        i = (i + 1) & mask;
+
+    return i;
+}
+
+void grow_sites(AllocationProfiler* p)
+{
+    p->sites_capacity *= 2;
+    p->sites = (AllocationSite*)realloc(p->sites, sizeof(AllocationSite) * p->sites_capacity);
+    free(p->site_lookup);
+    p->site_lookup = (uint32*)malloc(sizeof(uint32) * profiler_lookup_size(p));
+    memset(p->site_lookup, 0xff, sizeof(uint32) * profiler_lookup_size(p));
+
+    for (uint32 i = 0; i < p->num_sites; ++i)
+        p->site_lookup[find_or_add_site_lookup(p, p->sites[i].hash)] = i;
+}
+
+uint32 get_site(AllocationProfiler* p, const CapturedCallstack* callstack)
+{
+    auto hash = hash_data(callstack->frames, sizeof(void*) * callstack->num_frames);
+    auto lookup_index = find_or_add_site_lookup(p, hash);
+
+    if (p->site_lookup[lookup_index] != profiler_empty_lookup)
+        return p->site_lookup[lookup_index];
+
+    if (p->num_sites == p->sites_capacity)
+    {
+        grow_sites(p);
+        lookup_index = find_or_add_site_lookup(p, hash);
+    }
+
+    auto site_index = p->num_sites++;
+    auto site = p->sites + site_index;
+    memset(site, 0, sizeof(AllocationSite));
+    site->hash = hash;
+    site->callstack = *callstack;
+    p->site_lookup[lookup_index] = site_index;
+    return site_index;
+}
+
+// Every sample stands for interval allocations or bytes. Used to extrapolate totals in reports.
+uint64 estimated_bytes(const AllocationProfiler* p, const AllocationSite* site)
+{
+    return p->sampling == AllocationSampling::EveryNBytes ? site->samples * p->interval : site->bytes * p->interval;
+}
+
+uint64 estimated_allocations(const AllocationProfiler* p, const AllocationSite* site)
+{
+    if (p->sampling == AllocationSampling::EveryNthAllocation)
+        return site->samples * p->interval;
+
+    return site->bytes == 0 ? 0 : estimated_bytes(p, site) * site->samples / site->bytes;
+}
+
+void write_text_site(FILE* file, const AllocationProfiler* p, const AllocationSite* site)
+{
+    fprintf(file, "site %016llx: %llu samples, %llu bytes sampled, %llu live, %llu peak live, ~%llu allocations, ~%llu bytes\n",
+        site->hash, site->samples, site->bytes, site->live_bytes, site->peak_live_bytes,
+        estimated_allocations(p, site), estimated_bytes(p, site));
+
+    for (uint32 i = 0; i < site->callstack.num_frames; ++i)
+        fprintf(file, "    %p\n", site->callstack.frames[i]);
+}
+
+void write_json_site(FILE* file, const AllocationProfiler* p, const AllocationSite* site, bool last)
+{
+    fprintf(file, "  {\"site\": \"%016llx\", \"samples\": %llu, \"bytes\": %llu, \"live_bytes\": %llu, \"peak_live_bytes\": %llu, "
+        "\"estimated_allocations\": %llu, \"estimated_bytes\": %llu, \"frames\": [",
+        site->hash, site->samples, site->bytes, site->live_bytes, site->peak_live_bytes,
+        estimated_allocations(p, site), estimated_bytes(p, site));
+
+    for (uint32 i = 0; i < site->callstack.num_frames; ++i)
+        fprintf(file, i == 0 ? "\"%p\"" : ", \"%p\"", site->callstack.frames[i]);
+
+    fprintf(file, last ? "]}\n" : "]},\n");
+}
+
+} // namespace internal
+
+namespace allocation_profiler
+{
+
+void init(AllocationProfiler* p, CallstackCapturer* callstack_capturer, AllocationSampling sampling, uint64 interval)
+{
+    Assert(sampling == AllocationSampling::Off || interval > 0, "Allocation sampling interval must be positive");
+    p->callstack_capturer = callstack_capturer;
+    p->sampling = sampling;
+    p->interval = interval;
+    p->num_sites = 0;
+    p->sites_capacity = internal::profiler_initial_sites;
+    p->sites = (AllocationSite*)malloc(sizeof(AllocationSite) * p->sites_capacity);
+    p->site_lookup = (uint32*)malloc(sizeof(uint32) * internal::profiler_lookup_size(p));
+    memset(p->site_lookup, 0xff, sizeof(uint32) * internal::profiler_lookup_size(p));
+}
+
+void deinit(AllocationProfiler* p)
+{
+    free(p->sites);
+    free(p->site_lookup);
+}
+
+bool should_sample(const AllocationProfiler* p, uint64* until_next_sample, uint64 size)
+{
+    if (p->sampling == AllocationSampling::Off)
+        return false;
+
+    auto step = p->sampling == AllocationSampling::EveryNBytes ? size : 1;
+
+    if (*until_next_sample == 0)
+        *until_next_sample = p->interval;
+
+    if (step < *until_next_sample)
+    {
+        *until_next_sample -= step;
+        return false;
+    }
+
+    *until_next_sample = p->interval;
+    return true;
+}
+
+uint32 on_sampled_alloc(AllocationProfiler* p, uint64 size)
+{
+    auto callstack = p->callstack_capturer->capture(2, nullptr);
+    std::lock_guard<std::mutex> lock(p->mutex);
+    auto site_index = internal::get_site(p, &callstack);
+    auto site = p->sites + site_index;
+    ++site->samples;
+    site->bytes += size;
+    site->live_bytes += size;
+
+    if (site->live_bytes > site->peak_live_bytes)
+        site->peak_live_bytes = site->live_bytes;
+
+    return site_index;
+}
+
+void on_dealloc(AllocationProfiler* p, uint32 site, uint64 size)
+{
+    if (site == not_sampled)
+        return;
+
+    std::lock_guard<std::mutex> lock(p->mutex);
+    Assert(site < p->num_sites, "Deallocating from unknown allocation site");
+    Assert(p->sites[site].live_bytes >= size, "Deallocating more bytes than live at allocation site");
+    p->sites[site].live_bytes -= size;
+}
+
+bool write_report(AllocationProfiler* p, const char* filename, AllocationReportFormat format)
+{
+    auto file = fopen(filename, "w");
+
+    if (!file)
+        return false;
+
+    std::lock_guard<std::mutex> lock(p->mutex);
+    auto order = (uint32*)malloc(sizeof(uint32) * (p->num_sites + 1));
+
+    for (uint32 i = 0; i < p->num_sites; ++i)
+        order[i] = i;
+
+    auto sites = p->sites;
+    std::sort(order, order + p->num_sites, [sites](uint32 x, uint32 y) { return sites[x].bytes > sites[y].bytes; });
+
+    if (format == AllocationReportFormat::Json)
+        fprintf(file, "[\n");
+
+    for (uint32 i = 0; i < p->num_sites; ++i)
+    {
+        if (format == AllocationReportFormat::Json)
+            internal::write_json_site(file, p, sites + order[i], i == p->num_sites - 1);
+        else
+            internal::write_text_site(file, p, sites + order[i]);
+    }
+
+    if (format == AllocationReportFormat::Json)
+        fprintf(file, "]\n");
+
+    free(order);
+    fclose(file);
+    return true;
+}
+
+} // namespace allocation_profiler
+
+} // namespace bowtie
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "callstack_capturer_types.h"
+#include <mutex>
+
+namespace bowtie
+{
+
+struct CallstackCapturer;
+
+enum class AllocationSampling
+{
+    Off, EveryNthAllocation, EveryNBytes
+};
+
+enum class AllocationReportFormat
+{
+    Text, Json
+};
+
+// Aggregated samples of all allocations made from one callstack.
+struct AllocationSite
+{
+    uint64 hash;
+    CapturedCallstack callstack;
+    uint64 samples;
+    uint64 bytes;
+    uint64 live_bytes;
+    uint64 peak_live_bytes;
+};
+
+// Deciding whether to sample is left to the allocator, which keeps a countdown per thread. Only
+// recording and releasing samples take the profiler's mutex.
+struct AllocationProfiler
+{
+    CallstackCapturer* callstack_capturer;
+    AllocationSampling sampling;
+    uint64 interval;
+    std::mutex mutex;
+    uint32 num_sites;
+    uint32 sites_capacity;
+    AllocationSite* sites;
+    uint32* site_lookup; // Open addressed, sites_capacity * 2 entries.
+};
+
+namespace allocation_profiler
+{
+    static const uint32 not_sampled = (uint32)-1;
+
+    void init(AllocationProfiler* p, CallstackCapturer* callstack_capturer, AllocationSampling sampling, uint64 interval);
+    void deinit(AllocationProfiler* p);
+
+    // Called by allocators for every allocation, until_next_sample is the calling thread's countdown
+    // and starts at zero. Doesn't lock.
+    bool should_sample(const AllocationProfiler* p, uint64* until_next_sample, uint64 size);
+
+    // Records an allocation should_sample picked and returns its site. The allocator keeps the site
+    // and passes it to on_dealloc, which does nothing for not_sampled.
+    uint32 on_sampled_alloc(AllocationProfiler* p, uint64 size);
+    void on_dealloc(AllocationProfiler* p, uint32 site, uint64 size);
+
+    // Writes all sites, largest number of sampled bytes first. Returns false if the file couldn't
+    // be opened.
+    bool write_report(AllocationProfiler* p, const char* filename, AllocationReportFormat format);
+}
+
+}
@@ -1,51 +1,145 @@
 #include "allocator_helpers.h"
 #include "memory.h"
 #include "callstack_capturer.h"
+#include <cstdlib>
 
 namespace bowtie
 {
 
-namespace allocator_helpers
+namespace internal
 {
 
-void add_captured_callstack(CapturedCallstack* callstacks, const CapturedCallstack* cc)
+const uint32 callstacks_end_of_list = 0xffffffffu;
+
+uint32 callstack_bucket(const CapturedCallstacks* callstacks, const void* p)
+{
+    auto pi = uint64(uintptr_t(p)) >> 3;
+    return uint32((pi * 0x9E3779B97F4A7C15ull) >> 32) & (callstacks->num_buckets - 1);
+}
+
+void link_free_callstacks(CapturedCallstacks* callstacks, uint32 from, uint32 to)
 {
-    for (uint32 i = 0; i < memory::max_callstacks; ++i)
+    for (uint32 i = from; i < to; ++i)
     {
-        if (!callstacks[i].used)
-        {
-            callstacks[i] = *cc;
-            return;
-        }
+        callstacks->callstacks[i].used = false;
+        callstacks->next[i] = i + 1 < to ? i + 1 : callstacks->free_head;
+    }
+
+    callstacks->free_head = from;
+}
+
+void rebuild_callstack_buckets(CapturedCallstacks* callstacks)
+{
+    for (uint32 i = 0; i < callstacks->num_buckets; ++i)
+        callstacks->buckets[i] = callstacks_end_of_list;
+
+    for (uint32 i = 0; i < callstacks->capacity; ++i)
+    {
+        if (!callstacks->callstacks[i].used)
+            continue;
+
+        auto bucket = callstack_bucket(callstacks, callstacks->callstacks[i].ptr);
+        callstacks->next[i] = callstacks->buckets[bucket];
+        callstacks->buckets[bucket] = i;
     }
+}
+
+void grow_callstacks(CapturedCallstacks* callstacks)
+{
+    auto old_capacity = callstacks->capacity;
+    auto new_capacity = old_capacity * 2;
+    callstacks->callstacks = (CapturedCallstack*)realloc(callstacks->callstacks, sizeof(CapturedCallstack) * new_capacity);
+    callstacks->next = (uint32*)realloc(callstacks->next, sizeof(uint32) * new_capacity);
+    callstacks->buckets = (uint32*)realloc(callstacks->buckets, sizeof(uint32) * new_capacity);
+    callstacks->capacity = new_capacity;
+    callstacks->num_buckets = new_capacity;
+    link_free_callstacks(callstacks, old_capacity, new_capacity);
+    rebuild_callstack_buckets(callstacks);
+}
 
-    Error("Out of callstacks. Increase max_callstacks in memory.cpp.");
+} // namespace internal
+
+namespace allocator_helpers
+{
+
+CapturedCallstacks* create_captured_callstacks()
+{
+    auto callstacks = (CapturedCallstacks*)malloc(sizeof(CapturedCallstacks));
+    auto capacity = memory::initial_captured_callstacks;
+    callstacks->capacity = capacity;
+    callstacks->num_buckets = capacity;
+    callstacks->callstacks = (CapturedCallstack*)malloc(sizeof(CapturedCallstack) * capacity);
+    callstacks->next = (uint32*)malloc(sizeof(uint32) * capacity);
+    callstacks->buckets = (uint32*)malloc(sizeof(uint32) * capacity);
+    callstacks->free_head = internal::callstacks_end_of_list;
+    internal::link_free_callstacks(callstacks, 0, capacity);
+
+    for (uint32 i = 0; i < callstacks->num_buckets; ++i)
+        callstacks->buckets[i] = internal::callstacks_end_of_list;
+
+    return callstacks;
+}
+
+void destroy_captured_callstacks(CapturedCallstacks* callstacks)
+{
+    free(callstacks->callstacks);
+    free(callstacks->next);
+    free(callstacks->buckets);
+    free(callstacks);
 }
 
-void remove_captured_callstack(CapturedCallstack* callstacks, void* p)
+void add_captured_callstack(CapturedCallstacks* callstacks, const CapturedCallstack* cc)
 {
-    for (uint32 i = 0; i < memory::max_callstacks; ++i) {
-        if (callstacks[i].ptr == p)
+    if (callstacks->free_head == internal::callstacks_end_of_list)
+        internal::grow_callstacks(callstacks);
+
+    auto i = callstacks->free_head;
+    callstacks->free_head = callstacks->next[i];
+    callstacks->callstacks[i] = *cc;
+    callstacks->callstacks[i].used = true;
+    auto bucket = internal::callstack_bucket(callstacks, cc->ptr);
+    callstacks->next[i] = callstacks->buckets[bucket];
+    callstacks->buckets[bucket] = i;
+}
+
+void remove_captured_callstack(CapturedCallstacks* callstacks, void* p)
+{
+    auto bucket = internal::callstack_bucket(callstacks, p);
+    auto prev = internal::callstacks_end_of_list;
+
+    for (auto i = callstacks->buckets[bucket]; i != internal::callstacks_end_of_list; i = callstacks->next[i])
+    {
+        if (callstacks->callstacks[i].ptr != p)
         {
-            callstacks[i].used = false;
-            return;
+            prev = i;
+            continue;
         }
+
+        if (prev == internal::callstacks_end_of_list)
+            callstacks->buckets[bucket] = callstacks->next[i];
+        else
+            callstacks->next[prev] = callstacks->next[i];
+
+        callstacks->callstacks[i].used = false;
+        callstacks->next[i] = callstacks->free_head;
+        callstacks->free_head = i;
+        return;
     }
 
     Error("Failed to find callstack in remove_captured_callstack.");
 }
 
-void ensure_captured_callstacks_unused(CallstackCapturer* callstack_capturer, CapturedCallstack* callstacks)
+void ensure_captured_callstacks_unused(CallstackCapturer* callstack_capturer, const CapturedCallstacks* callstacks)
 {
-    for (uint32 i = 0; i < memory::max_callstacks; ++i)
+    for (uint32 i = 0; i < callstacks->capacity; ++i)
     {
-        if (!callstacks[i].used)
+        if (!callstacks->callstacks[i].used)
             continue;
 
-        callstack_capturer->print_callstack(L"Memory leak stack trace", callstacks + i);
+        callstack_capturer->print_callstack(L"Memory leak stack trace", callstacks->callstacks + i);
     }
 }
 
 }
 
-}
\ No newline at end of file
+}
@@ -1,11 +1,11 @@
 #pragma once
 
 #include "memory.h"
+#include "callstack_capturer_types.h"
 
 namespace bowtie
 {
 
-struct CapturedCallstack;
 struct CallstackCapturer;
 
 const uint32 HEADER_PAD_VALUE = 0xffffffffu;
@@ -14,20 +14,35 @@ const uint32 HEADER_PAD_VALUE = 0xffffffffu;
 const uint32 TRACING_MARKER = 0xfffffffeu;
 #endif
 
+// Callstacks of live allocations. Looked up by pointer through a chained hash, unused slots are
+// kept in a free list.
+struct CapturedCallstacks
+{
+    uint32 capacity;
+    uint32 num_buckets;
+    CapturedCallstack* callstacks;
+    uint32* next;
+    uint32* buckets;
+    uint32 free_head;
+};
+
 struct Header
 {
     #if defined(TRACING)
         uint32 tracing_marker;
     #endif
+    uint32 profiler_site;
     uint64 size;
 };
 
 namespace allocator_helpers
 {
 
-void add_captured_callstack(CapturedCallstack* callstacks, const CapturedCallstack* cc);
-void remove_captured_callstack(CapturedCallstack* callstacks, void* p);
-void ensure_captured_callstacks_unused(CallstackCapturer* callstack_capturer, CapturedCallstack* callstacks);
+CapturedCallstacks* create_captured_callstacks();
+void destroy_captured_callstacks(CapturedCallstacks* callstacks);
+void add_captured_callstack(CapturedCallstacks* callstacks, const CapturedCallstack* cc);
+void remove_captured_callstack(CapturedCallstacks* callstacks, void* p);
+void ensure_captured_callstacks_unused(CallstackCapturer* callstack_capturer, const CapturedCallstacks* callstacks);
 inline void* data_pointer(Header *header, uint32 align);
 inline Header *header(void *data);
 inline void fill(Header *header, void *data, uint32 size);
@@ -18,7 +18,7 @@ inline void fill(Header *header, void *data, uint64 size)
         header->tracing_marker = TRACING_MARKER;
     #endif
 
-    auto p = (uint64 *)memory::pointer_add(header, sizeof(Header));
+    auto p = (uint32 *)memory::pointer_add(header, sizeof(Header));
     while (p < data)
         *p++ = HEADER_PAD_VALUE;
 }
@@ -1,5 +1,6 @@
 #include "concurrent_ring_buffer.h"
 #include "memory.h"
+#include <cstring>
 
 namespace bowtie
 {
@@ -7,23 +8,33 @@ namespace bowtie
 namespace internal
 {
 
-void write(uint8** buffer, const void* data, uint32 size)
+uint8* ring_buffer_element(ConcurrentRingBuffer* b, uint64 head)
 {
-    memcpy(*buffer, data, size);
-    *buffer += size;
+    return b->start + (head % b->size) * b->element_size;
 }
 
-uint32 used(ConcurrentRingBuffer* b)
+uint32 ring_buffer_free(ConcurrentRingBuffer* b, uint32 wanted)
 {
-    if (b->write_head <= b->consume_head && b->has_wrapped)
-    {
-        auto end = (uint8*)memory::pointer_add(b->start, b->size * b->element_size);
-        auto used = (uint32)(end - b->consume_head) + (uint32)(b->write_head - b->start);
-        return used;
-    }
+    auto write_head = b->write_head.load(std::memory_order_relaxed);
+    auto free = b->size - uint32(write_head - b->_cached_consume_head);
 
-    auto used = (uint32)(b->write_head - b->consume_head);
-    return used;
+    if (free >= wanted)
+        return free;
+
+    b->_cached_consume_head = b->consume_head.load(std::memory_order_acquire);
+    return b->size - uint32(write_head - b->_cached_consume_head);
+}
+
+uint32 ring_buffer_available(ConcurrentRingBuffer* b, uint32 wanted)
+{
+    auto consume_head = b->consume_head.load(std::memory_order_relaxed);
+    auto available = uint32(b->_cached_write_head - consume_head);
+
+    if (available >= wanted)
+        return available;
+
+    b->_cached_write_head = b->write_head.load(std::memory_order_acquire);
+    return uint32(b->_cached_write_head - consume_head);
 }
 
 } // namespace internal
@@ -36,9 +47,10 @@ void init(ConcurrentRingBuffer* b, Allocator* , uint32 size, uint32 element_size
     b->size = size;
     b->element_size = element_size;
     b->start = (uint8*)memory::alloc_raw(&RenderThreadMemory, element_size * size);// (uint8*)allocator->alloc_raw(element_size * size);
-    b->write_head = b->start;
-    b->has_wrapped = false;
-    b->consume_head = b->start;
+    b->write_head = 0;
+    b->_cached_consume_head = 0;
+    b->consume_head = 0;
+    b->_cached_write_head = 0;
     //b->allocator = allocator;
 }
 
@@ -49,45 +61,75 @@ void deinit(ConcurrentRingBuffer*)
 
 void write_one(ConcurrentRingBuffer* b, const void* data)
 {
-    std::lock_guard<std::mutex> lock(b->mutex);
-    auto end = (uint8*)memory::pointer_add(b->start, b->size * b->element_size);
-    internal::write(&b->write_head, data, b->element_size);
-    
-    if (b->write_head == end)
-    {
-        b->write_head = b->start;
-        b->has_wrapped = true;
-    }
+    write_n(b, data, 1);
 }
 
-void* peek(ConcurrentRingBuffer* b)
+void write_n(ConcurrentRingBuffer* b, const void* data, uint32 n)
+{
+    Assert(internal::ring_buffer_free(b, n) >= n, "Trying to write more elements than fit in ring buffer");
+    auto write_head = b->write_head.load(std::memory_order_relaxed);
+    auto first = write_head % b->size;
+    auto before_wrap = b->size - first < n ? b->size - uint32(first) : n;
+    memcpy(internal::ring_buffer_element(b, write_head), data, before_wrap * b->element_size);
+    memcpy(b->start, memory::pointer_add(data, before_wrap * b->element_size), (n - before_wrap) * b->element_size);
+    b->write_head.store(write_head + n, std::memory_order_release);
+}
+
+void* write_pointer(ConcurrentRingBuffer* b)
+{
+    return internal::ring_buffer_element(b, b->write_head.load(std::memory_order_relaxed));
+}
+
+uint32 elements_until_wrap(ConcurrentRingBuffer* b)
 {
-    std::lock_guard<std::mutex> lock(b->mutex);
+    return b->size - uint32(b->write_head.load(std::memory_order_relaxed) % b->size);
+}
 
-    if (internal::used(b) == 0)
+void commit_n(ConcurrentRingBuffer* b, uint32 n)
+{
+    Assert(n <= elements_until_wrap(b) && internal::ring_buffer_free(b, n) >= n, "Trying to commit more elements than were free in ring buffer");
+    b->write_head.store(b->write_head.load(std::memory_order_relaxed) + n, std::memory_order_release);
+}
+
+bool fits_one(ConcurrentRingBuffer* b)
+{
+    return fits_n(b, 1);
+}
+
+bool fits_n(ConcurrentRingBuffer* b, uint32 n)
+{
+    return internal::ring_buffer_free(b, n) >= n;
+}
+
+void* peek(ConcurrentRingBuffer* b)
+{
+    if (internal::ring_buffer_available(b, 1) == 0)
         return nullptr;
 
-    return b->consume_head;
+    return internal::ring_buffer_element(b, b->consume_head.load(std::memory_order_relaxed));
 }
 
-void consume_one(ConcurrentRingBuffer* b)
+ConsumedRingBufferData peek_span(ConcurrentRingBuffer* b)
 {
-    std::lock_guard<std::mutex> lock(b->mutex);
-    auto end = (uint8*)memory::pointer_add(b->start, b->size * b->element_size);
-    memset(b->consume_head, 0, b->element_size);
-    b->consume_head += b->element_size;
+    auto available = internal::ring_buffer_available(b, b->size);
+    auto consume_head = b->consume_head.load(std::memory_order_relaxed);
+    auto before_wrap = b->size - uint32(consume_head % b->size);
+    ConsumedRingBufferData span = {};
+    span.data = internal::ring_buffer_element(b, consume_head);
+    span.size = available < before_wrap ? available : before_wrap;
+    return span;
+}
 
-    if (b->consume_head == end)
-    {
-        b->consume_head = b->start;
-        b->has_wrapped = false;
-    }
+void consume_one(ConcurrentRingBuffer* b)
+{
+    consume_n(b, 1);
 }
 
-bool fits_one(ConcurrentRingBuffer* b)
+void consume_n(ConcurrentRingBuffer* b, uint32 n)
 {
-    std::lock_guard<std::mutex> lock(b->mutex);
-    return (b->size * b->element_size) - internal::used(b) >= b->element_size;
+    auto consume_head = b->consume_head.load(std::memory_order_relaxed);
+    Assert(uint32(b->_cached_write_head - consume_head) >= n, "Trying to consume more elements than written to ring buffer");
+    b->consume_head.store(consume_head + n, std::memory_order_release);
 }
 
 } // namespace concurrent_ring_buffer
@@ -1,5 +1,5 @@
 #pragma once
-#include <mutex>
+#include <atomic>
 #include "option.h"
 
 namespace bowtie
@@ -7,18 +7,32 @@ namespace bowtie
 
 struct Allocator;
 
+namespace concurrent_ring_buffer
+{
+    static const uint32 cache_line_size = 64;
+}
+
+// Single producer, single consumer queue of fixed size elements. The heads count elements written
+// and consumed since init and only ever grow. Each side keeps its own head on a separate cache line
+// and a cached copy of the other side's head, which is only reloaded when the buffer looks full or
+// empty.
 struct ConcurrentRingBuffer
 {
     uint32 size;
     uint32 element_size;
     uint8* start;
-    uint8* write_head;
-    bool has_wrapped;
-    uint8* consume_head;
-    std::mutex mutex;
-    Allocator* allocator; 
+    Allocator* allocator;
+
+    uint8 _producer_padding[concurrent_ring_buffer::cache_line_size];
+    std::atomic<uint64> write_head;
+    uint64 _cached_consume_head;
+
+    uint8 _consumer_padding[concurrent_ring_buffer::cache_line_size];
+    std::atomic<uint64> consume_head;
+    uint64 _cached_write_head;
 };
 
+// Contiguous run of elements, size is in elements.
 struct ConsumedRingBufferData
 {
     void* data;
@@ -29,10 +43,23 @@ namespace concurrent_ring_buffer
 {
     void init(ConcurrentRingBuffer* b, Allocator* allocator, uint32 size, uint32 element_size);
     void deinit(ConcurrentRingBuffer* b);
+
+    // Producer side. Elements can also be written in place at write_pointer, up to
+    // elements_until_wrap of them, and then published with commit_n.
     void write_one(ConcurrentRingBuffer* b, const void* data);
+    void write_n(ConcurrentRingBuffer* b, const void* data, uint32 n);
+    bool fits_one(ConcurrentRingBuffer* b);
+    bool fits_n(ConcurrentRingBuffer* b, uint32 n);
+    void* write_pointer(ConcurrentRingBuffer* b);
+    uint32 elements_until_wrap(ConcurrentRingBuffer* b);
+    void commit_n(ConcurrentRingBuffer* b, uint32 n);
+
+    // Consumer side. peek_span returns the written elements up to where the buffer wraps, call it
+    // again after consuming them to get the rest.
     void* peek(ConcurrentRingBuffer* b);
+    ConsumedRingBufferData peek_span(ConcurrentRingBuffer* b);
     void consume_one(ConcurrentRingBuffer* b);
-    bool fits_one(ConcurrentRingBuffer* b);
+    void consume_n(ConcurrentRingBuffer* b, uint32 n);
 }
 
-}
\ No newline at end of file
+}
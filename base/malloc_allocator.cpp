@@ -3,7 +3,10 @@
 #include <cstdlib>
 #include "callstack_capturer.h"
 #include <cstring>
+#include <atomic>
 #include "allocator_helpers.h"
+#include "allocation_profiler.h"
+#include "thread_local.h"
 
 namespace bowtie
 {
@@ -11,45 +14,209 @@ namespace bowtie
 namespace internal
 {
 
-inline void* alloc(Allocator* a, uint64 size, uint32 align)
+const uint64 malloc_min_block_size = 64;
+const uint64 malloc_max_block_size = malloc_min_block_size << (malloc_allocator::num_size_classes - 1);
+
+std::atomic<uint32> malloc_num_threads;
+ThreadLocal uint32 malloc_thread_index_plus_one;
+
+// Threads are numbered on first use. The same index is used in every MallocAllocator.
+MallocThreadCache* thread_cache(MallocAllocator* a)
+{
+    if (malloc_thread_index_plus_one == 0)
+    {
+        malloc_thread_index_plus_one = malloc_num_threads.fetch_add(1) + 1;
+        Assert(malloc_thread_index_plus_one <= malloc_allocator::max_threads, "Too many threads using MallocAllocator, increase malloc_allocator::max_threads");
+    }
+
+    return a->_thread_caches + malloc_thread_index_plus_one - 1;
+}
+
+uint32 malloc_size_class(uint64 block_size)
+{
+    uint32 size_class = 0;
+    uint64 class_size = malloc_min_block_size;
+
+    while (class_size < block_size)
+    {
+        class_size *= 2;
+        ++size_class;
+    }
+
+    return size_class;
+}
+
+// Must be called with the mutex held.
+void merge_counters(MallocAllocator* a, MallocThreadCache* tc)
 {
-    const auto ts = allocator_helpers::size_with_padding(size, align);
-    auto h = (Header *)memory::align_forward(malloc(ts), memory::default_align);
+    a->total_allocated += tc->allocated;
+    a->total_allocations += (int32)tc->allocations;
+    a->lifetime_allocations += tc->lifetime_allocations;
+
+    // Blocks may be freed by another thread than the one that allocated them, so the total can
+    // be negative until every thread has merged.
+    if (int64(a->total_allocated) > int64(a->peak_allocated))
+        a->peak_allocated = a->total_allocated;
+
+    tc->allocated = 0;
+    tc->allocations = 0;
+    tc->lifetime_allocations = 0;
+    tc->operations_since_flush = 0;
+}
+
+void count_thread_operation(MallocAllocator* a, MallocThreadCache* tc)
+{
+    if (++tc->operations_since_flush < malloc_allocator::counter_flush_interval)
+        return;
+
+    std::lock_guard<std::mutex> lock(a->_mutex);
+    merge_counters(a, tc);
+}
+
+// Takes a batch of blocks from the shared pool, or mallocs a new block if it's empty.
+void* refill_thread_cache(MallocAllocator* a, MallocThreadCache* tc, uint32 size_class)
+{
+    {
+        std::lock_guard<std::mutex> lock(a->_mutex);
+        auto shared = a->_shared_free_lists + size_class;
+
+        for (uint32 i = 0; i < malloc_allocator::batch_size && *shared != nullptr; ++i)
+        {
+            auto block = *shared;
+            *shared = *(void**)block;
+            *(void**)block = tc->free_lists[size_class];
+            tc->free_lists[size_class] = block;
+            ++tc->num_free[size_class];
+        }
+    }
+
+    auto block = tc->free_lists[size_class];
+
+    if (block == nullptr)
+        return malloc(malloc_min_block_size << size_class);
+
+    tc->free_lists[size_class] = *(void**)block;
+    --tc->num_free[size_class];
+    return block;
+}
+
+void* take_block(MallocAllocator* a, MallocThreadCache* tc, uint64 block_size)
+{
+    if (block_size > malloc_max_block_size)
+        return malloc(block_size);
+
+    auto size_class = malloc_size_class(block_size);
+    auto block = tc->free_lists[size_class];
+
+    if (block == nullptr)
+        return refill_thread_cache(a, tc, size_class);
+
+    tc->free_lists[size_class] = *(void**)block;
+    --tc->num_free[size_class];
+    return block;
+}
+
+void return_block(MallocAllocator* a, MallocThreadCache* tc, void* block, uint64 block_size)
+{
+    if (block_size > malloc_max_block_size)
+    {
+        free(block);
+        return;
+    }
+
+    auto size_class = malloc_size_class(block_size);
+    *(void**)block = tc->free_lists[size_class];
+    tc->free_lists[size_class] = block;
+
+    if (++tc->num_free[size_class] < malloc_allocator::max_cached_blocks)
+        return;
+
+    std::lock_guard<std::mutex> lock(a->_mutex);
+    auto shared = a->_shared_free_lists + size_class;
+
+    for (uint32 i = 0; i < malloc_allocator::batch_size; ++i)
+    {
+        auto b = tc->free_lists[size_class];
+        tc->free_lists[size_class] = *(void**)b;
+        *(void**)b = *shared;
+        *shared = b;
+    }
+
+    tc->num_free[size_class] -= malloc_allocator::batch_size;
+}
+
+void free_list(void* block)
+{
+    while (block != nullptr)
+    {
+        auto next = *(void**)block;
+        free(block);
+        block = next;
+    }
+}
+
+inline void* alloc(MallocAllocator* a, uint64 size, uint32 align)
+{
+    auto tc = thread_cache(a);
+    auto ts = allocator_helpers::size_with_padding(size, align);
+
+    if (ts <= malloc_max_block_size)
+        ts = malloc_min_block_size << malloc_size_class(ts);
+
+    auto h = (Header *)memory::align_forward(take_block(a, tc, ts), memory::default_align);
     auto p = allocator_helpers::data_pointer(h, align);
     allocator_helpers::fill(h, p, ts);
-    ++a->total_allocations;
-    a->total_allocated += ts;
+    tc->allocated += ts;
+    ++tc->allocations;
+    ++tc->lifetime_allocations;
+    count_thread_operation(a, tc);
+    h->profiler_site = allocation_profiler::not_sampled;
+
+    if (a->profiler && allocation_profiler::should_sample(a->profiler, &tc->until_next_profiler_sample, ts))
+        h->profiler_site = allocation_profiler::on_sampled_alloc(a->profiler, ts);
 
+    // Tracing keeps the callstack of every allocation for leak reports, the profiler only samples.
     #if defined(TRACING)
+    {
         auto captured_callstack = a->callstack_capturer->capture(1, p);
+        std::lock_guard<std::mutex> lock(a->_tracing_mutex);
         allocator_helpers::add_captured_callstack(a->_captured_callstacks, &captured_callstack);
+    }
     #endif
 
     return p;
 }
 
-inline void dealloc(Allocator* a, void* p)
+inline void dealloc(MallocAllocator* a, void* p)
 {
     if (!p)
         return;
 
+    auto tc = thread_cache(a);
     auto h = allocator_helpers::header(p);
-    Assert(a->total_allocated >= h->size, "Trying to deallocate more memory than totally allocated.");
 
     #if defined(TRACING)
         Assert(h->tracing_marker == TRACING_MARKER, "Tracing is active, but could not find TRACING_MARKER in allocation header.");
         h->tracing_marker = 0;
     #endif
-    
-    Assert(a->total_allocations - 1 < a->total_allocations && a->total_allocations - 1 >= 0, "Trying to deallocate, but there are no current allocations.");
-    --a->total_allocations;
-    a->total_allocated -= h->size;
+
+    auto block_size = h->size;
+    Assert(block_size >= malloc_min_block_size, "Trying to deallocate a block with a corrupt header.");
+    tc->allocated -= block_size;
+    --tc->allocations;
+    count_thread_operation(a, tc);
+
+    if (a->profiler)
+        allocation_profiler::on_dealloc(a->profiler, h->profiler_site, block_size);
 
     #if defined(TRACING)
+    {
+        std::lock_guard<std::mutex> lock(a->_tracing_mutex);
         allocator_helpers::remove_captured_callstack(a->_captured_callstacks, p);
+    }
     #endif
 
-    free(h);
+    return_block(a, tc, h, block_size);
 }
 
 } // namespace internal
@@ -71,4 +238,45 @@ void MallocAllocator::dealloc(void *p)
     internal::dealloc(this, p);
 }
 
+namespace malloc_allocator
+{
+
+void init(MallocAllocator* a, const char* name, CallstackCapturer* callstack_capturer)
+{
+    memory::init_allocator(a, name, callstack_capturer);
+    memset(a->_thread_caches, 0, sizeof(MallocThreadCache) * max_threads);
+    memset(a->_shared_free_lists, 0, sizeof(void*) * num_size_classes);
+}
+
+void deinit(MallocAllocator* a)
+{
+    flush_counters(a);
+
+    for (uint32 i = 0; i < max_threads; ++i)
+    {
+        for (uint32 sc = 0; sc < num_size_classes; ++sc)
+            internal::free_list(a->_thread_caches[i].free_lists[sc]);
+    }
+
+    for (uint32 sc = 0; sc < num_size_classes; ++sc)
+        internal::free_list(a->_shared_free_lists[sc]);
+
+    memory::deinit_allocator(a);
+}
+
+void flush_counters(MallocAllocator* a)
+{
+    std::lock_guard<std::mutex> lock(a->_mutex);
+
+    for (uint32 i = 0; i < max_threads; ++i)
+        internal::merge_counters(a, a->_thread_caches + i);
+
+    // Per thread counters may go negative when blocks are freed by another thread than the one that
+    // allocated them, only the merged totals can be checked.
+    Assert(int64(a->total_allocated) >= 0, "Deallocated more memory than was allocated.");
+    Assert(int32(a->total_allocations) >= 0, "Deallocated more allocations than were made.");
+}
+
+} // namespace malloc_allocator
+
 } // namespace bowtie
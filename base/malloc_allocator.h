@@ -1,15 +1,58 @@
 #pragma once
 
 #include "memory.h"
+#include <mutex>
 
 namespace bowtie
 {
 
+namespace malloc_allocator
+{
+    static const uint32 num_size_classes = 7; // 64, 128, 256 ... 4096 bytes including header
+    static const uint32 max_threads = 16;
+    static const uint32 batch_size = 32; // Blocks moved between a thread cache and the shared pool at once.
+    static const uint32 max_cached_blocks = 2 * batch_size;
+    static const uint32 counter_flush_interval = 256;
+}
+
+// Blocks freed by a thread, and its allocation counters not yet merged into the allocator's.
+struct MallocThreadCache
+{
+    void* free_lists[malloc_allocator::num_size_classes];
+    uint32 num_free[malloc_allocator::num_size_classes];
+    int64 allocated;
+    int64 allocations;
+    uint64 lifetime_allocations;
+    uint32 operations_since_flush;
+    uint64 until_next_profiler_sample;
+};
+
+// Allocates using malloc. Small blocks are recycled through per-thread caches, so several threads
+// may allocate and deallocate concurrently. The counters in Allocator lag behind by up to
+// counter_flush_interval operations per thread, call malloc_allocator::flush_counters for exact
+// numbers. The profiler only captures callstacks of sampled allocations, so allocations that hit the
+// thread cache and aren't sampled never lock. TRACING builds also record every allocation in the
+// callstack table for leak reports, under _tracing_mutex.
 struct MallocAllocator : Allocator
 {
+    MallocThreadCache _thread_caches[malloc_allocator::max_threads];
+    void* _shared_free_lists[malloc_allocator::num_size_classes];
+    std::mutex _mutex; // Guards the shared free lists and the merged counters.
+    std::mutex _tracing_mutex;
+
     void* alloc(uint64 size, uint32 align = memory::default_align);
     void* alloc_raw(uint64 size, uint32 align = memory::default_align);
     void dealloc(void* p);
 };
 
+namespace malloc_allocator
+{
+    void init(MallocAllocator* a, const char* name, CallstackCapturer* callstack_capturer);
+    void deinit(MallocAllocator* a);
+
+    // Merges the counters of all threads into the allocator. No other thread may use the allocator
+    // while this runs.
+    void flush_counters(MallocAllocator* a);
+}
+
 }
@@ -2,7 +2,9 @@
 #include <cstring>
 #include <cstdlib>
 #include "allocator_helpers.h"
-#include <mutex>
+#include "thread_local.h"
+#include <atomic>
+#include <thread>
 
 namespace bowtie
 {
@@ -17,13 +19,22 @@ void init_allocator(Allocator* a, const char* name, CallstackCapturer* callstack
     a->callstack_capturer = callstack_capturer;
     a->total_allocated = 0;
     a->total_allocations = 0;
-    memset(a->_captured_callstacks, 0, sizeof(CapturedCallstack) * memory::max_callstacks);
+    a->peak_allocated = 0;
+    a->lifetime_allocations = 0;
+    a->profiler = nullptr;
+
+    #ifdef TRACING
+        a->_captured_callstacks = allocator_helpers::create_captured_callstacks();
+    #else
+        a->_captured_callstacks = nullptr;
+    #endif
 }
 
 void deinit_allocator(Allocator* a)
 {
     #ifdef TRACING
         allocator_helpers::ensure_captured_callstacks_unused(a->callstack_capturer, a->_captured_callstacks);
+        allocator_helpers::destroy_captured_callstacks(a->_captured_callstacks);
     #endif
 
     free(a->name);
@@ -43,6 +54,56 @@ void init(PermanentMemory* memory, void* buffer, uint32 size)
     memory->start = (uint8*)buffer;
     memory->end = memory->start + size;
     memory->head = memory->start;
+    memory->committed = memory->end;
+    memory->backing = MemoryBacking::Buffer;
+    memory->page_size = PageSize::Normal;
+    memory->num_markers = 0;
+    memory->peak_head = memory->start;
+}
+
+void init_reserved(PermanentMemory* memory, uint64 size, PageSize page_size)
+{
+    Assert(size > 0, "Trying to reserve empty permanent memory");
+    memory->start = (uint8*)virtual_memory::reserve(size, page_size);
+    memory->end = memory->start + size;
+    memory->head = memory->start;
+    memory->committed = memory->start;
+    memory->backing = MemoryBacking::Reserved;
+    memory->page_size = page_size;
+    memory->num_markers = 0;
+    memory->peak_head = memory->start;
+}
+
+void deinit(PermanentMemory* memory)
+{
+    if (memory->backing == MemoryBacking::Reserved)
+        virtual_memory::release(memory->start, memory->end - memory->start);
+}
+
+void commit_to(PermanentMemory* memory, uint8* p)
+{
+    auto new_committed = (uint8*)memory::align_forward(p, (uint32)virtual_memory::commit_size(memory->page_size));
+
+    if (new_committed > memory->end)
+        new_committed = memory->end;
+
+    virtual_memory::commit(memory->committed, new_committed - memory->committed, memory->page_size);
+    memory->committed = new_committed;
+}
+
+// Gives back the whole commit blocks above p.
+void decommit_from(PermanentMemory* memory, uint8* p)
+{
+    if (memory->backing != MemoryBacking::Reserved)
+        return;
+
+    auto new_committed = (uint8*)memory::align_forward(p, (uint32)virtual_memory::commit_size(memory->page_size));
+
+    if (new_committed >= memory->committed)
+        return;
+
+    virtual_memory::decommit(new_committed, memory->committed - new_committed);
+    memory->committed = new_committed;
 }
 
 void* alloc(PermanentMemory* memory, uint32 size, uint32 align)
@@ -54,16 +115,46 @@ void* alloc(PermanentMemory* memory, uint32 size, uint32 align)
 
 void* alloc_raw(PermanentMemory* memory, uint32 size, uint32 align)
 {
-    auto total_size = size + align;
-    Assert(memory->head + total_size <= memory->end, "Out of memory in permanent allocator");
-    auto p = memory::align_forward(memory->head, memory::default_align);
-    memory->head += total_size;
+    auto p = (uint8*)memory::align_forward(memory->head, align);
+    Assert(p + size <= memory->end, "Out of memory in permanent allocator");
+    memory->head = p + size;
+
+    if (memory->head > memory->committed)
+        commit_to(memory, memory->head);
+
+    if (memory->head > memory->peak_head)
+        memory->peak_head = memory->head;
+
     return p;
 }
 
 void rewind(PermanentMemory* memory)
 {
     memory->head = memory->start;
+    memory->num_markers = 0;
+    decommit_from(memory, memory->head);
+}
+
+void push_marker(PermanentMemory* memory)
+{
+    Assert(memory->num_markers < memory::max_markers, "Out of permanent memory markers, increase memory::max_markers");
+    memory->markers[memory->num_markers++] = memory->head;
+}
+
+void pop_marker(PermanentMemory* memory)
+{
+    Assert(memory->num_markers > 0, "Trying to pop permanent memory marker, but none is pushed");
+    memory->head = memory->markers[--memory->num_markers];
+    decommit_from(memory, memory->head);
+}
+
+MemoryUsage usage(const PermanentMemory* memory)
+{
+    MemoryUsage u = {};
+    u.used = memory->head - memory->start;
+    u.peak = memory->peak_head - memory->start;
+    u.capacity = memory->end - memory->start;
+    return u;
 }
 
 }
@@ -71,19 +162,110 @@ void rewind(PermanentMemory* memory)
 namespace temp_memory
 {
 
-std::mutex mutex;
+const uint32 frame_id_arena_shift = 56;
+const uint64 frame_id_frame_mask = (1ull << frame_id_arena_shift) - 1;
+
+struct Arena
+{
+    uint8* start;
+    uint8* end;
+    uint8* head;
+    uint8* committed;
+    uint64 frame;
+    uint8* frame_starts[max_frames_in_flight];
+
+    // Frames before this one may be reused. Written by the consumer, read by the owning thread.
+    std::atomic<uint64> retired_frame;
+
+    // Written by the owning thread in new_frame, read by stats.
+    std::atomic<uint64> live_bytes;
+    std::atomic<uint64> peak_live_bytes;
+    std::atomic<uint64> previous_frame_bytes;
+    std::atomic<uint64> peak_frame_bytes;
+    uint64 frame_bytes;
+};
+
 uint8* start;
 uint8* end;
-uint8* head;
-uint8* head_at_frame_start;
+uint8* shared_start;
+MemoryBacking backing;
+PageSize page_size;
+std::atomic<uint64> claimed;
+std::atomic<uint64> shared_head;
+std::atomic<uint64> shared_peak_head;
+std::atomic<uint64> shared_bytes_since_stats;
+std::atomic<uint64> shared_peak_bytes_between_stats;
+std::atomic<uint32> num_arenas;
+Arena arenas[max_threads];
+ThreadLocal Arena* thread_arena;
 
-void init(void* memory, uint64 total_size)
+uint64 frame_id(const Arena* a, uint64 frame)
 {
+    return (uint64(a - arenas) << frame_id_arena_shift) | frame;
+}
+
+void init(void* memory, uint64 total_size, uint64 shared_size)
+{
+    Assert(shared_size <= total_size, "Shared temp memory is larger than total temp memory");
     start = (uint8*)memory;
     end = start + total_size;
-    head = start;
-    head_at_frame_start = head;
-    memset(head, 0xffffffff, total_size);
+    shared_start = end - shared_size;
+    backing = MemoryBacking::Buffer;
+    page_size = PageSize::Normal;
+    claimed = 0;
+    shared_head = 0;
+    shared_peak_head = 0;
+    shared_bytes_since_stats = 0;
+    shared_peak_bytes_between_stats = 0;
+    num_arenas = 0;
+}
+
+void init_reserved(uint64 total_size, uint64 shared_size, PageSize pages)
+{
+    init(virtual_memory::reserve(total_size, pages), total_size, shared_size);
+    backing = MemoryBacking::Reserved;
+    page_size = pages;
+
+    // Any thread may allocate from the shared region, so it is committed up front.
+    if (shared_size > 0)
+        virtual_memory::commit(shared_start, shared_size, page_size);
+}
+
+void deinit()
+{
+    if (backing == MemoryBacking::Reserved)
+        virtual_memory::release(start, end - start);
+}
+
+void init_thread(uint64 size)
+{
+    Assert(thread_arena == nullptr, "Thread already has a temp memory region");
+
+    // Keeps the commit granularity aligned for the regions claimed after this one.
+    if (backing == MemoryBacking::Reserved)
+    {
+        auto granularity = virtual_memory::commit_size(page_size);
+        size = (size + granularity - 1) / granularity * granularity;
+    }
+
+    auto region_start = start + claimed.fetch_add(size);
+    Assert(region_start + size <= shared_start, "Out of temp memory when claiming thread region");
+    auto arena_index = num_arenas.fetch_add(1);
+    Assert(arena_index < max_threads, "Too many threads with temp memory regions, increase temp_memory::max_threads");
+    auto a = arenas + arena_index;
+    a->start = region_start;
+    a->end = region_start + size;
+    a->head = a->start;
+    a->committed = backing == MemoryBacking::Reserved ? a->start : a->end;
+    a->frame = 0;
+    a->frame_starts[0] = a->head;
+    a->retired_frame = 0;
+    a->live_bytes = 0;
+    a->peak_live_bytes = 0;
+    a->previous_frame_bytes = 0;
+    a->peak_frame_bytes = 0;
+    a->frame_bytes = 0;
+    thread_arena = a;
 }
 
 void* alloc(uint64 size, uint32 align)
@@ -93,26 +275,182 @@ void* alloc(uint64 size, uint32 align)
     return p;
 }
 
-void* alloc_raw(uint64 size, uint32 align)
-{   
-    std::lock_guard<std::mutex> lock(mutex);
-    auto total_size = size + align;
+// Returns where an allocation fits without touching memory of unretired frames, which starts at
+// live_start, or nullptr if it doesn't fit.
+uint8* place(const Arena* a, const uint8* live_start, uint64 size, uint32 align)
+{
+    auto p = (uint8*)memory::align_forward(a->head, align);
+    auto live_has_wrapped = a->head < live_start;
 
-    if (head + total_size > end)
+    if (p + size > a->end)
     {
-        Assert(head_at_frame_start < head + total_size, "Allocation will go past where head was at frame start");
-        head = start;
+        if (live_has_wrapped)
+            return nullptr;
+
+        live_has_wrapped = a->head != live_start;
+        p = (uint8*)memory::align_forward(a->start, align);
+        Assert(p + size <= a->end, "Allocation is larger than thread temp memory region");
     }
-    
-    Assert(head_at_frame_start <= head || head_at_frame_start > head + total_size, "Allocation will go past where head was at frame start");
-    auto p = memory::align_forward(head, memory::default_align);
-    head += total_size;
+
+    if (live_has_wrapped && p + size >= live_start)
+        return nullptr;
+
     return p;
 }
 
-void new_frame()
+// The region is committed front to back the first time around, after that it's reused.
+void arena_commit_to(Arena* a, uint8* p)
+{
+    auto new_committed = (uint8*)memory::align_forward(p, (uint32)virtual_memory::commit_size(page_size));
+
+    if (new_committed > a->end)
+        new_committed = a->end;
+
+    virtual_memory::commit(a->committed, new_committed - a->committed, page_size);
+    a->committed = new_committed;
+}
+
+void* arena_alloc(Arena* a, uint64 size, uint32 align)
+{
+    while (true)
+    {
+        auto oldest_frame = a->retired_frame.load(std::memory_order_acquire);
+        auto p = place(a, a->frame_starts[oldest_frame % max_frames_in_flight], size, align);
+
+        if (p != nullptr)
+        {
+            if (p + size > a->committed)
+                arena_commit_to(a, p + size);
+
+            a->frame_bytes += p + size - a->head;
+            a->head = p + size;
+            return p;
+        }
+
+        Assert(oldest_frame < a->frame, "Thread temp memory region exhausted within one frame");
+        std::this_thread::yield();
+    }
+}
+
+// Fallback for threads without a region of their own. Several threads may race here, so the
+// head is an offset that is bumped with compare and swap.
+void* shared_alloc(uint64 size, uint32 align)
+{
+    auto shared_size = uint64(end - shared_start);
+    auto total_size = size + align;
+    Assert(total_size <= shared_size, "Allocation is larger than shared temp memory");
+    auto offset = shared_head.load(std::memory_order_relaxed);
+    uint64 allocation_start;
+    uint64 new_offset;
+
+    do
+    {
+        allocation_start = offset + total_size > shared_size ? 0 : offset;
+        new_offset = allocation_start + total_size;
+    }
+    while (!shared_head.compare_exchange_weak(offset, new_offset, std::memory_order_relaxed));
+
+    shared_bytes_since_stats.fetch_add(total_size, std::memory_order_relaxed);
+    auto peak_head = shared_peak_head.load(std::memory_order_relaxed);
+
+    while (new_offset > peak_head && !shared_peak_head.compare_exchange_weak(peak_head, new_offset, std::memory_order_relaxed))
+        ;
+
+    return memory::align_forward(shared_start + allocation_start, align);
+}
+
+void* alloc_raw(uint64 size, uint32 align)
+{
+    auto a = thread_arena;
+
+    if (a != nullptr)
+        return arena_alloc(a, size, align);
+
+    return shared_alloc(size, align);
+}
+
+void update_stats(Arena* a)
+{
+    auto live_start = a->frame_starts[a->retired_frame.load(std::memory_order_relaxed) % max_frames_in_flight];
+    auto live = a->head >= live_start ? uint64(a->head - live_start) : uint64((a->end - live_start) + (a->head - a->start));
+    a->live_bytes.store(live, std::memory_order_relaxed);
+
+    if (live > a->peak_live_bytes.load(std::memory_order_relaxed))
+        a->peak_live_bytes.store(live, std::memory_order_relaxed);
+
+    a->previous_frame_bytes.store(a->frame_bytes, std::memory_order_relaxed);
+
+    if (a->frame_bytes > a->peak_frame_bytes.load(std::memory_order_relaxed))
+        a->peak_frame_bytes.store(a->frame_bytes, std::memory_order_relaxed);
+
+    a->frame_bytes = 0;
+}
+
+uint64 new_frame()
+{
+    auto a = thread_arena;
+    Assert(a != nullptr, "Thread has no temp memory region to start a frame in");
+    ++a->frame;
+
+    while (a->frame - a->retired_frame.load(std::memory_order_acquire) >= max_frames_in_flight)
+        std::this_thread::yield();
+
+    a->frame_starts[a->frame % max_frames_in_flight] = a->head;
+    update_stats(a);
+    return frame_id(a, a->frame);
+}
+
+uint64 frame()
+{
+    auto a = thread_arena;
+    Assert(a != nullptr, "Thread has no temp memory region");
+    return frame_id(a, a->frame);
+}
+
+void retire_frame(uint64 frame)
+{
+    auto a = arenas + (frame >> frame_id_arena_shift);
+    auto frame_in_arena = frame & frame_id_frame_mask;
+
+    // Commands dispatched after a frame's last command, but before the next frame starts, may
+    // still point into the retired frame's memory. Keep it alive until the next frame is retired.
+    if (frame_in_arena > a->retired_frame.load(std::memory_order_relaxed))
+        a->retired_frame.store(frame_in_arena, std::memory_order_release);
+}
+
+uint32 stats(TempMemoryStats* out, uint32 max_stats)
 {
-    head_at_frame_start = head;
+    auto n = num_arenas.load(std::memory_order_acquire);
+    n = n < max_threads ? n : max_threads;
+    n = n < max_stats ? n : max_stats;
+
+    for (uint32 i = 0; i < n; ++i)
+    {
+        auto a = arenas + i;
+        auto s = out + i;
+        s->live.used = a->live_bytes.load(std::memory_order_relaxed);
+        s->live.peak = a->peak_live_bytes.load(std::memory_order_relaxed);
+        s->live.capacity = a->end - a->start;
+        s->previous_frame_bytes = a->previous_frame_bytes.load(std::memory_order_relaxed);
+        s->peak_frame_bytes = a->peak_frame_bytes.load(std::memory_order_relaxed);
+    }
+
+    return n;
+}
+
+void shared_stats(TempMemoryStats* out)
+{
+    auto bytes = shared_bytes_since_stats.exchange(0, std::memory_order_relaxed);
+    auto peak_bytes = shared_peak_bytes_between_stats.load(std::memory_order_relaxed);
+
+    while (bytes > peak_bytes && !shared_peak_bytes_between_stats.compare_exchange_weak(peak_bytes, bytes, std::memory_order_relaxed))
+        ;
+
+    out->live.used = shared_head.load(std::memory_order_relaxed);
+    out->live.peak = shared_peak_head.load(std::memory_order_relaxed);
+    out->live.capacity = uint64(end - shared_start);
+    out->previous_frame_bytes = bytes;
+    out->peak_frame_bytes = bytes > peak_bytes ? bytes : peak_bytes;
 }
 
 }
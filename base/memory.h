@@ -18,6 +18,7 @@ namespace memory
 
     void init_allocator(Allocator* a, const char* name, CallstackCapturer* callstack_capturer);
     void deinit_allocator(Allocator* a);
+    inline void count_allocation(Allocator* a, uint64 size);
 }
 
 // Aligns p to the specified alignment by moving it forward if necessary and returns the result.
@@ -54,23 +55,74 @@ inline const void *memory::pointer_sub(const void *p, uint64 bytes)
     return (const void*)((const uint8*)p - bytes);
 }
 
+// Updates the bookkeeping of a when it hands out size bytes.
+inline void memory::count_allocation(Allocator* a, uint64 size)
+{
+    ++a->total_allocations;
+    ++a->lifetime_allocations;
+    a->total_allocated += size;
+
+    if (a->total_allocated > a->peak_allocated)
+        a->peak_allocated = a->total_allocated;
+}
+
 extern PermanentMemory MainThreadMemory;
 extern PermanentMemory RenderThreadMemory;
 
 namespace memory
 {
     void init(PermanentMemory* memory, void* buffer, uint32 size);
+
+    // Reserves size bytes of address space and commits it as allocations need it.
+    void init_reserved(PermanentMemory* memory, uint64 size, PageSize page_size);
+    void deinit(PermanentMemory* memory);
     void* alloc(PermanentMemory* memory, uint32 size, uint32 align = memory::default_align);
     void* alloc_raw(PermanentMemory* memory, uint32 size, uint32 align = memory::default_align);
     void rewind(PermanentMemory* memory);
+
+    // Saves the current head. Everything allocated after it is freed by the matching pop_marker,
+    // so markers must be popped in reverse order of pushing. Popping and rewinding decommit the
+    // reserved pages above the new head.
+    void push_marker(PermanentMemory* memory);
+    void pop_marker(PermanentMemory* memory);
+    MemoryUsage usage(const PermanentMemory* memory);
 }
 
 namespace temp_memory
 {
-    void init(void* memory, uint64 total_size);
+    static const uint32 max_threads = 8;
+    static const uint32 max_frames_in_flight = 4;
+
+    // The last shared_size bytes of memory are shared by threads which haven't called init_thread.
+    void init(void* memory, uint64 total_size, uint64 shared_size);
+
+    // Like init, but reserves the memory. Thread regions are committed as they're used.
+    void init_reserved(uint64 total_size, uint64 shared_size, PageSize page_size);
+    void deinit();
+
+    // Claims a private region of size bytes for the calling thread. Allocations from that thread
+    // are then lock-free bumps in the region.
+    void init_thread(uint64 size);
     void* alloc(uint64 size, uint32 align = memory::default_align);
     void* alloc_raw(uint64 size, uint32 align = memory::default_align);
-    void new_frame();
+
+    // Starts a new frame in the calling thread's region and returns its id. Memory allocated during
+    // a frame is not reused until the frame after it has been retired, so it may be read by other
+    // threads until then. Waits if max_frames_in_flight frames are still unretired.
+    uint64 new_frame();
+
+    // Returns the id of the calling thread's current frame.
+    uint64 frame();
+
+    // Called by the consumer of a frame's memory once it is done with it. Frames are retired in order.
+    void retire_frame(uint64 frame);
+
+    // Fills out stats for every thread region, returns the number of regions. Safe to call from any thread.
+    uint32 stats(TempMemoryStats* out, uint32 max_stats);
+
+    // Stats of the shared region. It has no frames, used is the position of its head and the frame
+    // figures count the bytes allocated since the previous call. Safe to call from any thread.
+    void shared_stats(TempMemoryStats* out);
 }
 
 namespace debug_memory
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "callstack_capturer_types.h"
+#include "virtual_memory.h"
 
 namespace bowtie
 {
@@ -8,25 +9,58 @@ namespace bowtie
 namespace memory
 {
     static const uint32 default_align = 8;
-    static const uint32 max_callstacks = 4096;
+    static const uint32 initial_captured_callstacks = 1024;
+    static const uint32 max_markers = 16;
 }
 
+enum class MemoryBacking
+{
+    Buffer, // Fully committed memory owned by the caller.
+    Reserved // Reserved address space, committed on demand.
+};
+
 struct PermanentMemory
 {
     uint8* start;
     uint8* end;
     uint8* head;
+    uint8* committed;
+    MemoryBacking backing;
+    PageSize page_size;
+    uint8* markers[memory::max_markers];
+    uint32 num_markers;
+    uint8* peak_head;
+};
+
+struct MemoryUsage
+{
+    uint64 used;
+    uint64 peak;
+    uint64 capacity;
+};
+
+// Usage of one thread's temp memory region, updated by the owning thread when it starts a frame.
+struct TempMemoryStats
+{
+    MemoryUsage live; // Memory of all unretired frames.
+    uint64 previous_frame_bytes;
+    uint64 peak_frame_bytes;
 };
 
 struct CallstackCapturer;
+struct CapturedCallstacks;
+struct AllocationProfiler;
 
 struct Allocator
 {
     CallstackCapturer* callstack_capturer;
-    CapturedCallstack _captured_callstacks[memory::max_callstacks];
+    CapturedCallstacks* _captured_callstacks;
+    AllocationProfiler* profiler; // Optional, sampled allocation profiling.
     char* name;
     uint32 total_allocations;
     uint64 total_allocated;
+    uint64 peak_allocated;
+    uint64 lifetime_allocations;
 
     virtual void* alloc(uint64 size, uint32 align = memory::default_align) = 0;
     virtual void* alloc_raw(uint64 size, uint32 align = memory::default_align) = 0; // Does not memset to zero.
@@ -5,7 +5,11 @@ namespace bowtie
 {
 uint64 hash_str(const char* str)
 {
-    auto len = strlen(str);
+    return hash_data(str, strlen(str));
+}
+
+uint64 hash_data(const void* data_start, uint64 len)
+{
     auto seed = 0;
 
     const uint64 m = 0xc6a4a7935bd1e995ULL;
@@ -13,7 +17,7 @@ uint64 hash_str(const char* str)
 
     uint64 h = seed ^ (len * m);
 
-    const uint64 * data = (const uint64 *)str;
+    const uint64 * data = (const uint64 *)data_start;
     const uint64 * end = data + (len/8);
 
     while(data != end)
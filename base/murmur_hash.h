@@ -6,5 +6,6 @@ namespace bowtie
 {
 
 uint64 hash_str(const char* str);
+uint64 hash_data(const void* data, uint64 len);
 
 }
\ No newline at end of file
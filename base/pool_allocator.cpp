@@ -0,0 +1,173 @@
+#include "pool_allocator.h"
+#include <cstring>
+
+namespace bowtie
+{
+
+namespace internal
+{
+
+const uint32 pool_large_allocation = (uint32)-1;
+const uint32 pool_min_block_size = 8;
+
+// Precedes every allocation, keeps the payload 8 byte aligned.
+struct PoolBlockHeader
+{
+    uint32 size_class;
+    uint32 backing_offset; // Only used by large allocations.
+};
+
+uint32 pool_size_class(uint64 size)
+{
+    uint32 size_class = 0;
+    uint64 block_size = pool_min_block_size;
+
+    while (block_size < size)
+    {
+        block_size *= 2;
+        ++size_class;
+    }
+
+    return size_class;
+}
+
+uint32 pool_block_size(uint32 size_class)
+{
+    return pool_min_block_size << size_class;
+}
+
+// Large allocations store their size in front of the header, for bookkeeping on dealloc.
+void* pool_alloc_large(PoolAllocator* a, uint64 size, uint32 align)
+{
+    const auto prefix_size = sizeof(uint64) + sizeof(PoolBlockHeader);
+    auto backing_p = a->backing->alloc_raw(size + prefix_size + align);
+    auto p = memory::align_forward(memory::pointer_add(backing_p, prefix_size), align);
+    auto h = (PoolBlockHeader*)memory::pointer_sub(p, sizeof(PoolBlockHeader));
+    h->size_class = pool_large_allocation;
+    h->backing_offset = uint32((uint8*)p - (uint8*)backing_p);
+    *(uint64*)memory::pointer_sub(h, sizeof(uint64)) = size;
+    return p;
+}
+
+void* pool_alloc_from_size_class(PoolAllocator* a, uint32 size_class)
+{
+    auto sc = a->_size_classes + size_class;
+    PoolBlockHeader* h;
+
+    if (sc->free_list != nullptr)
+    {
+        h = (PoolBlockHeader*)sc->free_list;
+        sc->free_list = *(void**)memory::pointer_add(h, sizeof(PoolBlockHeader));
+    }
+    else
+    {
+        const auto stride = sizeof(PoolBlockHeader) + pool_block_size(size_class);
+
+        if (sc->bump + stride > sc->bump_end)
+        {
+            // First pointer-sized bytes of each slab link it into the list freed on deinit.
+            auto slab = (uint8*)a->backing->alloc_raw(pool_allocator::slab_size);
+            *(void**)slab = a->_slabs;
+            a->_slabs = slab;
+            sc->bump = slab + sizeof(void*);
+            sc->bump_end = slab + pool_allocator::slab_size;
+        }
+
+        h = (PoolBlockHeader*)sc->bump;
+        sc->bump += stride;
+    }
+
+    h->size_class = size_class;
+    return memory::pointer_add(h, sizeof(PoolBlockHeader));
+}
+
+void* pool_alloc(PoolAllocator* a, uint64 size, uint32 align)
+{
+    auto size_class = pool_size_class(size);
+    void* p;
+    
+    if (size_class >= pool_allocator::num_size_classes || align > memory::default_align)
+    {
+        p = pool_alloc_large(a, size, align);
+        memory::count_allocation(a, size);
+    }
+    else
+    {
+        p = pool_alloc_from_size_class(a, size_class);
+        memory::count_allocation(a, pool_block_size(size_class));
+    }
+
+    return p;
+}
+
+void pool_dealloc(PoolAllocator* a, void* p)
+{
+    if (!p)
+        return;
+
+    auto h = (PoolBlockHeader*)memory::pointer_sub(p, sizeof(PoolBlockHeader));
+    Assert(a->total_allocations > 0, "Trying to deallocate, but there are no current allocations.");
+    --a->total_allocations;
+
+    if (h->size_class == pool_large_allocation)
+    {
+        a->total_allocated -= *(uint64*)memory::pointer_sub(h, sizeof(uint64));
+        a->backing->dealloc(memory::pointer_sub(p, h->backing_offset));
+        return;
+    }
+
+    Assert(h->size_class < pool_allocator::num_size_classes, "Trying to deallocate memory not allocated by pool allocator.");
+    a->total_allocated -= pool_block_size(h->size_class);
+    auto sc = a->_size_classes + h->size_class;
+    *(void**)p = sc->free_list;
+    sc->free_list = h;
+}
+
+} // namespace internal
+
+void* PoolAllocator::alloc(uint64 size, uint32 align)
+{
+    auto p = internal::pool_alloc(this, size, align);
+    memset(p, 0, size);
+    return p;
+}
+
+void* PoolAllocator::alloc_raw(uint64 size, uint32 align)
+{
+    return internal::pool_alloc(this, size, align);
+}
+
+void PoolAllocator::dealloc(void* p)
+{
+    internal::pool_dealloc(this, p);
+}
+
+namespace pool_allocator
+{
+
+void init(PoolAllocator* a, const char* name, Allocator* backing)
+{
+    memory::init_allocator(a, name, backing->callstack_capturer);
+    a->backing = backing;
+    a->_slabs = nullptr;
+    memset(a->_size_classes, 0, sizeof(PoolSizeClass) * num_size_classes);
+}
+
+void deinit(PoolAllocator* a)
+{
+    memory::deinit_allocator(a);
+    auto slab = a->_slabs;
+
+    while (slab != nullptr)
+    {
+        auto next = *(void**)slab;
+        a->backing->dealloc(slab);
+        slab = next;
+    }
+
+    a->_slabs = nullptr;
+}
+
+} // namespace pool_allocator
+
+} // namespace bowtie
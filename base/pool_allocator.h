@@ -0,0 +1,41 @@
+#pragma once
+
+#include "memory.h"
+
+namespace bowtie
+{
+
+namespace pool_allocator
+{
+    static const uint32 num_size_classes = 8; // 8, 16, 32 ... 1024 bytes
+    static const uint32 slab_size = 65536;
+}
+
+struct PoolSizeClass
+{
+    void* free_list;
+    uint8* bump;
+    uint8* bump_end;
+};
+
+// Serves small allocations from fixed size classes carved out of slabs, which are allocated from a
+// backing allocator. Larger or over-aligned allocations go straight to the backing allocator. Not
+// thread safe.
+struct PoolAllocator : Allocator
+{
+    Allocator* backing;
+    PoolSizeClass _size_classes[pool_allocator::num_size_classes];
+    void* _slabs;
+
+    void* alloc(uint64 size, uint32 align = memory::default_align);
+    void* alloc_raw(uint64 size, uint32 align = memory::default_align);
+    void dealloc(void* p);
+};
+
+namespace pool_allocator
+{
+    void init(PoolAllocator* a, const char* name, Allocator* backing);
+    void deinit(PoolAllocator* a);
+}
+
+}
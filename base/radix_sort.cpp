@@ -0,0 +1,74 @@
+#include "radix_sort.h"
+#include <cstring>
+
+namespace bowtie
+{
+
+namespace radix_sort
+{
+
+void sort(uint64* keys, uint32* values, uint64* temp_keys, uint32* temp_values, uint32 num)
+{
+    if (num == 0)
+        return;
+
+    const uint32 num_passes = sizeof(uint64);
+    const uint32 num_buckets = 256;
+    uint32 counts[num_passes][num_buckets];
+    memset(counts, 0, sizeof(counts));
+
+    for (uint32 i = 0; i < num; ++i)
+    {
+        auto key = keys[i];
+
+        for (uint32 pass = 0; pass < num_passes; ++pass)
+            ++counts[pass][(key >> (pass * 8)) & 0xff];
+    }
+
+    auto from_keys = keys;
+    auto from_values = values;
+    auto to_keys = temp_keys;
+    auto to_values = temp_values;
+
+    for (uint32 pass = 0; pass < num_passes; ++pass)
+    {
+        auto pass_counts = counts[pass];
+
+        if (pass_counts[(from_keys[0] >> (pass * 8)) & 0xff] == num)
+            continue;
+
+        uint32 offset = 0;
+
+        for (uint32 bucket = 0; bucket < num_buckets; ++bucket)
+        {
+            auto count = pass_counts[bucket];
+            pass_counts[bucket] = offset;
+            offset += count;
+        }
+
+        for (uint32 i = 0; i < num; ++i)
+        {
+            auto key = from_keys[i];
+            auto dest = pass_counts[(key >> (pass * 8)) & 0xff]++;
+            to_keys[dest] = key;
+            to_values[dest] = from_values[i];
+        }
+
+        auto swap_keys = from_keys;
+        from_keys = to_keys;
+        to_keys = swap_keys;
+        auto swap_values = from_values;
+        from_values = to_values;
+        to_values = swap_values;
+    }
+
+    if (from_keys == keys)
+        return;
+
+    memcpy(keys, from_keys, sizeof(uint64) * num);
+    memcpy(values, from_values, sizeof(uint32) * num);
+}
+
+} // namespace radix_sort
+
+} // namespace bowtie
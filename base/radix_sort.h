@@ -0,0 +1,15 @@
+#pragma once
+
+#include "types.h"
+
+namespace bowtie
+{
+
+namespace radix_sort
+{
+    // Stable ascending sort of keys, values are moved along with their keys. temp_keys and temp_values
+    // must have room for num elements. Passes over bytes that are the same in all keys are skipped.
+    void sort(uint64* keys, uint32* values, uint64* temp_keys, uint32* temp_values, uint32 num);
+}
+
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+#if defined(_MSC_VER)
+    #define ThreadLocal __declspec(thread)
+#else
+    #define ThreadLocal thread_local
+#endif
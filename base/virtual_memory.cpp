@@ -0,0 +1,102 @@
+#include "virtual_memory.h"
+#include "memory.h"
+
+#if defined(_WIN32)
+    #include <Windows.h>
+#else
+    #include <sys/mman.h>
+#endif
+
+namespace bowtie
+{
+
+namespace virtual_memory
+{
+
+const uint64 normal_commit_size = 65536; // 64 kilobytes
+const uint64 huge_page_size = 2097152; // 2 megabytes
+
+#if defined(_WIN32)
+
+// Large pages on Windows need a privilege and can't be committed lazily, so PageSize::Huge only
+// affects the commit granularity here.
+void* reserve(uint64 size, PageSize)
+{
+    auto p = VirtualAlloc(nullptr, size, MEM_RESERVE, PAGE_NOACCESS);
+    Assert(p != nullptr, "Failed to reserve virtual memory");
+    return p;
+}
+
+void commit(void* p, uint64 size, PageSize)
+{
+    auto result = VirtualAlloc(p, size, MEM_COMMIT, PAGE_READWRITE);
+    Assert(result != nullptr, "Failed to commit virtual memory");
+}
+
+void decommit(void* p, uint64 size)
+{
+    VirtualFree(p, size, MEM_DECOMMIT);
+}
+
+void release(void* p, uint64)
+{
+    VirtualFree(p, 0, MEM_RELEASE);
+}
+
+#else
+
+void* reserve(uint64 size, PageSize page_size)
+{
+    auto alignment = page_size == PageSize::Huge ? huge_page_size : 0;
+    auto reserved_size = size + alignment;
+    auto p = (uint8*)mmap(nullptr, reserved_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    Assert(p != MAP_FAILED, "Failed to reserve virtual memory");
+
+    if (alignment == 0)
+        return p;
+
+    // Trim the over-reserved range so that the start is huge page aligned.
+    auto aligned = (uint8*)memory::align_forward(p, (uint32)alignment);
+    auto tail = reserved_size - (aligned - p) - size;
+
+    if (aligned != p)
+        munmap(p, aligned - p);
+
+    if (tail > 0)
+        munmap(aligned + size, tail);
+
+    return aligned;
+}
+
+void commit(void* p, uint64 size, PageSize page_size)
+{
+    auto result = mprotect(p, size, PROT_READ | PROT_WRITE);
+    Assert(result == 0, "Failed to commit virtual memory");
+
+    #if defined(MADV_HUGEPAGE)
+        if (page_size == PageSize::Huge)
+            madvise(p, size, MADV_HUGEPAGE);
+    #endif
+}
+
+void decommit(void* p, uint64 size)
+{
+    madvise(p, size, MADV_DONTNEED);
+    mprotect(p, size, PROT_NONE);
+}
+
+void release(void* p, uint64 size)
+{
+    munmap(p, size);
+}
+
+#endif
+
+uint64 commit_size(PageSize page_size)
+{
+    return page_size == PageSize::Huge ? huge_page_size : normal_commit_size;
+}
+
+} // namespace virtual_memory
+
+} // namespace bowtie
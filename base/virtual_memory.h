@@ -0,0 +1,26 @@
+#pragma once
+
+namespace bowtie
+{
+
+enum class PageSize
+{
+    Normal, Huge
+};
+
+namespace virtual_memory
+{
+    // Reserves address space without backing it by memory. With PageSize::Huge the range is aligned
+    // so it can be backed by transparent huge pages.
+    void* reserve(uint64 size, PageSize page_size);
+
+    // Makes a reserved range usable. Pages are backed lazily by the OS on first touch.
+    void commit(void* p, uint64 size, PageSize page_size);
+    void decommit(void* p, uint64 size);
+    void release(void* p, uint64 size);
+
+    // Granularity at which arenas commit memory.
+    uint64 commit_size(PageSize page_size);
+}
+
+}
@@ -7,6 +7,7 @@
 namespace bowtie_windows
 {
     bowtie::Engine* s_engine;
+    bowtie::AllocationProfiler* s_allocation_profiler;
 }
 
 void window_resized_callback(const bowtie::Vector2u* resolution)
@@ -16,6 +17,9 @@ void window_resized_callback(const bowtie::Vector2u* resolution)
 
 void key_down_callback(bowtie::Key key)
 {
+    if (key == bowtie::Key::F12)
+        bowtie::allocation_profiler::write_report(bowtie_windows::s_allocation_profiler, "allocation_profile.json", bowtie::AllocationReportFormat::Json);
+
     bowtie::engine::key_pressed(bowtie_windows::s_engine, key);
 }
 
@@ -24,26 +28,28 @@ void key_up_callback(bowtie::Key key)
     bowtie::engine::key_released(bowtie_windows::s_engine, key);
 }
 
-bowtie::PermanentMemory bowtie::MainThreadMemory;
-bowtie::PermanentMemory bowtie::RenderThreadMemory;
-
-void* alloc(bowtie::uint64 size)
+void memory_log_sink(const char* line)
 {
-    return VirtualAlloc(0, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    OutputDebugStringA(line);
+    OutputDebugStringA("\n");
 }
 
-void dealloc(void* p)
-{
-    VirtualFree(p, 0, MEM_RELEASE);
-}
+bowtie::PermanentMemory bowtie::MainThreadMemory;
+bowtie::PermanentMemory bowtie::RenderThreadMemory;
 
 DWORD WINAPI renderer_thread_proc(void* param)
 {
     auto renderer = (bowtie::Renderer*)param;    
+    const auto render_thread_temp_memory_size = 16777216u; // 16 megabytes
+    bowtie::temp_memory::init_thread(render_thread_temp_memory_size);
     bowtie::renderer::initialize_thread(renderer);
 
     while (renderer->active)
+    {
+        auto frame = bowtie::temp_memory::new_frame();
         bowtie::renderer::process_command_queue(renderer);
+        bowtie::temp_memory::retire_frame(frame);
+    }
 
     return 0;
 }
@@ -52,18 +58,25 @@ int main()
 {
     // Alloc memory
     const auto permanent_memory_size = 33554432u; // 32 megabyte
-    void* main_thread_memory_buffer = alloc(permanent_memory_size);
-    bowtie::memory::init(&bowtie::MainThreadMemory, main_thread_memory_buffer, permanent_memory_size);
-    void* render_thread_memory_buffer = alloc(permanent_memory_size);
-    bowtie::memory::init(&bowtie::RenderThreadMemory, render_thread_memory_buffer, permanent_memory_size);
+    bowtie::memory::init_reserved(&bowtie::MainThreadMemory, permanent_memory_size, bowtie::PageSize::Normal);
+    bowtie::memory::init_reserved(&bowtie::RenderThreadMemory, permanent_memory_size, bowtie::PageSize::Normal);
     const auto temp_memory_size = 134217728u; // 128 megabytes
-    void* temp_memory_buffer = alloc(temp_memory_size);
-    bowtie::temp_memory::init(temp_memory_buffer, temp_memory_size);
+    const auto shared_temp_memory_size = 16777216u; // 16 megabytes
+    const auto main_thread_temp_memory_size = 67108864u; // 64 megabytes
+    bowtie::temp_memory::init_reserved(temp_memory_size, shared_temp_memory_size, bowtie::PageSize::Normal);
+    bowtie::temp_memory::init_thread(main_thread_temp_memory_size);
     auto callstack_capturer = bowtie::windows::callstack_capturer::create();
     auto allocator = new bowtie::MallocAllocator();
-    bowtie::memory::init_allocator(allocator, "default allocator", &callstack_capturer);
-    auto renderer_allocator = new bowtie::MallocAllocator();
-    bowtie:: memory::init_allocator(renderer_allocator, "renederer allocator", &callstack_capturer);
+    bowtie::malloc_allocator::init(allocator, "default allocator", &callstack_capturer);
+    const auto allocation_sampling_interval = 65536u; // Sample once every 64 kilobytes
+    bowtie::AllocationProfiler allocation_profiler = {};
+    bowtie::allocation_profiler::init(&allocation_profiler, &callstack_capturer, bowtie::AllocationSampling::EveryNBytes, allocation_sampling_interval);
+    allocator->profiler = &allocation_profiler;
+    bowtie_windows::s_allocation_profiler = &allocation_profiler;
+    auto renderer_backing_allocator = new bowtie::MallocAllocator();
+    bowtie::malloc_allocator::init(renderer_backing_allocator, "renderer backing allocator", &callstack_capturer);
+    auto renderer_allocator = new bowtie::PoolAllocator();
+    bowtie::pool_allocator::init(renderer_allocator, "renderer allocator", renderer_backing_allocator);
 
     // Setup engine and renderer
     bowtie::Timer timer = {};
@@ -74,6 +87,8 @@ int main()
     bowtie::Engine engine = {};
     bowtie::engine::init(&engine, allocator, &opengl_renderer, &renderer_context, renderer_allocator, &timer);
     bowtie_windows::s_engine = &engine;
+    const auto memory_log_interval = 600u; // About every ten seconds
+    bowtie::engine::set_memory_log_sink(&engine, memory_log_sink, memory_log_interval);
 
     // Create window
     auto resolution = bowtie::vector2u::create(1280, 720);
@@ -99,9 +114,11 @@ int main()
     bowtie::renderer::deinit(&engine.renderer);
 
     // Dealloc memory
-    bowtie::memory::deinit_allocator(renderer_allocator);
-    bowtie::memory::deinit_allocator(allocator);
-    dealloc(temp_memory_buffer);
-    dealloc(main_thread_memory_buffer);
-    dealloc(render_thread_memory_buffer);
+    bowtie::pool_allocator::deinit(renderer_allocator);
+    bowtie::malloc_allocator::deinit(renderer_backing_allocator);
+    bowtie::malloc_allocator::deinit(allocator);
+    bowtie::allocation_profiler::deinit(&allocation_profiler);
+    bowtie::temp_memory::deinit();
+    bowtie::memory::deinit(&bowtie::MainThreadMemory);
+    bowtie::memory::deinit(&bowtie::RenderThreadMemory);
 }
@@ -22,10 +22,19 @@ void init(Engine* e, Allocator* allocator, ConcreteRenderer* concrete_renderer,
 {
     e->allocator = allocator;
     e->timer = timer;
-    renderer::init(&e->renderer, concrete_renderer, renderer_allocator, renderer_context);
+
+    // Command lists may be recorded on any thread, so they can't use the renderer allocator.
+    renderer::init(&e->renderer, concrete_renderer, renderer_allocator, allocator, renderer_context);
     resource_store::init(&e->resource_store, allocator, &e->renderer.render_interface);
     entity_manager::init(&e->entity_manager, allocator);
     memset(&e->keyboard, 0, sizeof(Keyboard));
+    e->frame_pacing = FramePacing::Throughput;
+    e->frames_in_flight = 2;
+    render_interface::set_frames_in_flight(&e->renderer.render_interface, e->frames_in_flight);
+    memory_telemetry::init(&e->memory_telemetry);
+    memory_telemetry::add_allocator(&e->memory_telemetry, allocator);
+    memory_telemetry::add_render_thread_snapshot(&e->memory_telemetry, &e->renderer.memory_snapshot, renderer_allocator);
+    memory_telemetry::set_renderer(&e->memory_telemetry, &e->renderer);
     e->timer->start();
     game::init(&e->_game, allocator, e, &e->renderer.render_interface);
 }
@@ -35,19 +44,55 @@ void deinit(Engine* e)
     game::deinit(&e->_game);
     entity_manager::deinit(&e->entity_manager);
     resource_store::deinit(&e->resource_store);
+
+    // Let the render thread destroy what was released above before it's stopped.
+    render_interface::submit_command_lists(&e->renderer.render_interface);
+    render_interface::wait_until_idle(&e->renderer.render_interface);
+    render_interface::deinit(&e->renderer.render_interface);
 }
 
 World* create_world(Engine* e)
 {
+    // The world's component buffers live in permanent memory after this marker. It's popped when the
+    // world is destroyed, so worlds must be destroyed in reverse order of creation.
+    auto marker = MainThreadMemory.num_markers;
+    memory::push_marker(&MainThreadMemory);
     auto world = (World*)e->allocator->alloc(sizeof(World));
     world::init(world, e->allocator, &e->renderer.render_interface, &e->resource_store);
+    world->permanent_memory_marker = marker;
     render_interface::create_render_world(&e->renderer.render_interface, world);
     return world;
 }
 
 void destroy_world(Engine* e, World* world)
 {
+    Assert(MainThreadMemory.num_markers == world->permanent_memory_marker + 1, "Worlds must be destroyed in reverse order of creation");
+    render_interface::destroy_render_world(&e->renderer.render_interface, world);
     e->allocator->dealloc(world);
+    memory::pop_marker(&MainThreadMemory);
+}
+
+void set_frame_pacing(Engine* e, FramePacing frame_pacing)
+{
+    e->frame_pacing = frame_pacing;
+    auto frames_in_flight = frame_pacing == FramePacing::LowLatency ? 1 : e->frames_in_flight;
+    render_interface::set_frames_in_flight(&e->renderer.render_interface, frames_in_flight);
+}
+
+void set_frames_in_flight(Engine* e, uint32 frames_in_flight)
+{
+    e->frames_in_flight = frames_in_flight;
+    set_frame_pacing(e, e->frame_pacing);
+}
+
+const MemoryTelemetry* telemetry(const Engine* e)
+{
+    return &e->memory_telemetry;
+}
+
+void set_memory_log_sink(Engine* e, MemoryLogSink sink, uint32 interval_in_frames)
+{
+    memory_telemetry::set_log_sink(&e->memory_telemetry, sink, interval_in_frames);
 }
 
 void key_pressed(Engine* e, Key key)
@@ -65,9 +110,12 @@ void resize(Engine* e, const Vector2u* resolution)
     render_interface::resize(&e->renderer.render_interface, resolution);
 }
 
+// Temp memory of a frame is kept until the frame after it is retired.
+static_assert(temp_memory::max_frames_in_flight > render_interface::max_frames_in_flight, "Temp memory can't hold all frames in flight");
+
 void update_and_render(Engine* e)
 {
-    render_interface::wait_until_idle(&e->renderer.render_interface);
+    render_interface::wait_for_frame_slot(&e->renderer.render_interface);
 
     if (!e->_game.started)
         game::start(&e->_game);
@@ -78,13 +126,17 @@ void update_and_render(Engine* e)
     e->_time_since_start += dt;
     game::update(&e->_game, dt);
     game::draw(&e->_game);
-    auto command = render_interface::create_command(RendererCommand::CombineRenderedWorlds);
-    render_interface::dispatch(&e->renderer.render_interface, &command);
+    render_interface::submit_command_lists(&e->renderer.render_interface);
+    CombineRenderedWorldsData crwd;
+    crwd.temp_memory_frame = temp_memory::frame();
+    crwd.frame_ticket = render_interface::submit_frame(&e->renderer.render_interface);
+    render_interface::dispatch(&e->renderer.render_interface, RendererCommand::CombineRenderedWorlds, &crwd, sizeof(CombineRenderedWorldsData));
 
     if (keyboard::key_pressed(&e->keyboard, Key::F5))
         resource_store::reload_all(&e->resource_store);
 
     keyboard::reset_pressed_released(&e->keyboard);
+    memory_telemetry::sample(&e->memory_telemetry);
 }
 
 } // namespace engine
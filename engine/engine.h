@@ -1,6 +1,7 @@
 #pragma once
 #include <game/game.h>
 #include "keyboard.h"
+#include "memory_telemetry.h"
 #include "resource_store.h"
 #include "entity/entity_manager.h"
 #include "renderer/renderer.h"
@@ -15,6 +16,12 @@ struct World;
 struct Timer;
 struct Vector2u;
 
+enum class FramePacing
+{
+    LowLatency, // One frame in flight, input is never more than a frame old.
+    Throughput // Up to frames_in_flight frames in flight, simulation overlaps rendering.
+};
+
 struct Engine
 {
     Allocator* allocator;
@@ -22,10 +29,13 @@ struct Engine
     ResourceStore resource_store;
     Renderer renderer;
     Keyboard keyboard;
+    MemoryTelemetry memory_telemetry;
     Game _game;
     real32 _time_elapsed_previous_frame;
     real32 _time_since_start;
     Timer* timer;
+    FramePacing frame_pacing;
+    uint32 frames_in_flight;
 };
 
 namespace engine
@@ -36,10 +46,14 @@ namespace engine
     World* create_world(Engine* e);
     void destroy_world(Engine* e, World* world);
     const Keyboard* keyboard(const Engine* e);
+    const MemoryTelemetry* telemetry(const Engine* e);
+    void set_memory_log_sink(Engine* e, MemoryLogSink sink, uint32 interval_in_frames);
     void key_pressed(Engine* e, Key key);
     void key_released(Engine* e, Key key);
     void resize(Engine* e, const Vector2u* resolution);
     void update_and_render(Engine* e);
+    void set_frame_pacing(Engine* e, FramePacing frame_pacing);
+    void set_frames_in_flight(Engine* e, uint32 frames_in_flight); // Used in FramePacing::Throughput.
 
 }
 
@@ -2,6 +2,9 @@
 #include "sprite_renderer_component.h"
 #include "../../rect.h"
 #include "../../material.h"
+#include "../../renderer/render_resource_types.h"
+#include "../../renderer/render_interface.h"
+#include "../../world.h"
 #include <base/vector4.h>
 #include <base/matrix4.h>
 #include <base/quad.h>
@@ -57,8 +60,18 @@ void swap(SpriteRendererComponent* c, uint32 i1, uint32 i2)
     internal_copy(&c->data, c->header.num, i1);
 }
 
-void mark_dirty(SpriteRendererComponent* c, uint32 index)
+void move(SpriteRendererComponent* c, uint32 from, uint32 to)
 {
+    if (from == to)
+        return;
+
+    internal_copy(&c->data, from, to);
+    c->header.index_by_entity_index[entity::index(c->data.entity[to])] = to;
+}
+
+void mark_dirty(SpriteRendererComponent* c, uint32 index, uint32 field)
+{
+    c->dirty_fields |= field;
     auto dd = component::mark_dirty(&c->header, index);
 
     if (dd.new_index == dd.old_index)
@@ -98,20 +111,47 @@ void create(Entity e, const Rect* rect, const Color* color)
 
 void destroy(SpriteRendererComponent* c, Entity e)
 {
-    auto i = GetIndex(c, e);
-    --c->header.num;
-
-    if (i == c->header.num)
-        return;
-        
-    internal_copy(&c->data, c->header.num, i);
+    auto h = &c->header;
+    auto hole = GetIndex(c, e);
+    auto render_handle = c->data.render_handle[hole];
+
+    // New sprites don't exist on the render side yet.
+    if (render_handle != NotInitialized)
+        render_interface::destroy_resources(e.world->render_interface, RenderResourceData::SpriteRenderer, e.world->render_handle, &render_handle, 1);
+
+    // The hole is filled with the last component of its range, whose slot is filled from the next
+    // range, so that dirty, clean and new components stay contiguous.
+    auto num_dirty = component::num_dirty(h);
+    auto first_new = h->first_new == component::NotAssigned ? h->num : h->first_new;
+
+    if (hole < num_dirty)
+    {
+        move(c, num_dirty - 1, hole);
+        hole = num_dirty - 1;
+        --h->last_dirty_index;
+    }
+
+    if (hole < first_new)
+    {
+        move(c, first_new - 1, hole);
+        hole = first_new - 1;
+
+        if (h->first_new != component::NotAssigned)
+            --h->first_new;
+    }
+
+    move(c, h->num - 1, hole);
+    --h->num;
+
+    if (h->first_new == h->num)
+        component::reset_new(h);
 }
 
 void set_rect(SpriteRendererComponent* c, Entity e, const Rect* rect)
 {
     auto i = GetIndex(c, e);
     c->data.rect[i] = *rect;
-    mark_dirty(c, i);
+    mark_dirty(c, i, 0);
 }
 
 const Rect* rect(SpriteRendererComponent* c, Entity e)
@@ -123,7 +163,7 @@ void set_color(SpriteRendererComponent* c, Entity e, const Color* color)
 {
     auto i = GetIndex(c, e);
     c->data.color[i] = *color;
-    mark_dirty(c, i);
+    mark_dirty(c, i, sprite_renderer_field::Color);
 }
 
 const Color* color(SpriteRendererComponent* c, Entity e)
@@ -146,7 +186,7 @@ void set_material(Entity e, Material* material)
     auto c = &e.world->sprite_renderer_components;
     auto i = GetIndex(c, e);
     c->data.material[i] = *material;
-    mark_dirty(c, i);
+    mark_dirty(c, i, sprite_renderer_field::Material);
 }
 
 RenderResourceHandle render_handle(SpriteRendererComponent* c, Entity e)
@@ -158,7 +198,7 @@ void set_geometry(SpriteRendererComponent* c, Entity e, const Quad* geometry)
 {
     auto i = GetIndex(c, e);
     c->data.geometry[i] = *geometry;
-    mark_dirty(c, i);
+    mark_dirty(c, i, sprite_renderer_field::Geometry);
 }
 
 const Quad* transform(SpriteRendererComponent* c, Entity e)
@@ -170,25 +210,47 @@ void set_depth(SpriteRendererComponent* c, Entity e, int32 depth)
 {
     auto i = GetIndex(c, e);
     c->data.depth[i] = depth;
-    mark_dirty(c, i);
+    mark_dirty(c, i, sprite_renderer_field::Depth);
+}
+
+void reset_dirty(SpriteRendererComponent* c)
+{
+    component::reset_dirty(&c->header);
+    c->dirty_fields = 0;
 }
 
-void* copy_dirty_data(SpriteRendererComponent* c)
+void copy_dirty_data(SpriteRendererComponent* c, void* buffer)
 {
     auto num_dirty = component::num_dirty(&c->header);
-    void* buffer = temp_memory::alloc_raw(component_size * num_dirty);
-    auto data = initialize_data(buffer, num_dirty);
-    copy(&c->data, &data, num_dirty);
-    return buffer;
+    auto update = sprite_renderer_update::from_buffer(buffer, num_dirty, c->dirty_fields);
+    memcpy(update.render_handle, c->data.render_handle, num_dirty * sizeof(RenderResourceHandle));
+
+    if (update.geometry != nullptr)
+        memcpy(update.geometry, c->data.geometry, num_dirty * sizeof(Quad));
+
+    if (update.color != nullptr)
+        memcpy(update.color, c->data.color, num_dirty * sizeof(Color));
+
+    if (update.material != nullptr)
+    {
+        for (uint32 i = 0; i < num_dirty; ++i)
+            update.material[i] = c->data.material[i].render_handle;
+    }
+
+    if (update.depth != nullptr)
+        memcpy(update.depth, c->data.depth, num_dirty * sizeof(int32));
+}
+
+uint32 dirty_data_size(const SpriteRendererComponent* c)
+{
+    return sprite_renderer_update::size(component::num_dirty(&c->header), c->dirty_fields);
 }
 
-void* copy_new_data(SpriteRendererComponent* c)
+void copy_new_data(SpriteRendererComponent* c, void* buffer)
 {
     auto num_new = component::num_new(&c->header);
-    void* buffer = temp_memory::alloc_raw(component_size * num_new);
     auto data = initialize_data(buffer, num_new);
     copy_offset(&c->data, &data, num_new, c->header.first_new, 0);
-    return buffer;
 }
 
 SpriteRendererComponentData create_data_from_buffer(void* buffer, uint32 num)
@@ -31,6 +31,7 @@ struct SpriteRendererComponent
     ComponentHeader header;
     void* buffer;
     SpriteRendererComponentData data;
+    uint32 dirty_fields; // sprite_renderer_field::Mask of the fields changed on any component since reset_dirty.
 };
 
 namespace sprite_renderer_component
@@ -38,6 +39,7 @@ namespace sprite_renderer_component
     extern uint32 component_size;
     void init(SpriteRendererComponent* c);
     void create(Entity e, const Rect* rect, const Color* color);
+    // Also destroys the sprite on the render side, once the frame is submitted.
     void destroy(SpriteRendererComponent* c, Entity e);
     void set_rect(SpriteRendererComponent* c, Entity e, const Rect* rect);
     const Rect* rect(SpriteRendererComponent* c, Entity e);
@@ -49,9 +51,16 @@ namespace sprite_renderer_component
     RenderResourceHandle render_handle(SpriteRendererComponent* c, Entity e);
     void set_geometry(SpriteRendererComponent* c, Entity e, const Quad* geometry);
     const Quad* geometry(SpriteRendererComponent* c, Entity e);
+    // Depth must be within the int16 range.
     void set_depth(SpriteRendererComponent* c, Entity e, int32 depth);
-    void* copy_dirty_data(SpriteRendererComponent* c);
-    void* copy_new_data(SpriteRendererComponent* c);
+    void reset_dirty(SpriteRendererComponent* c);
+
+    // Copies the dirty fields of the dirty components into buffer, laid out for sprite_renderer_update.
+    void copy_dirty_data(SpriteRendererComponent* c, void* buffer);
+    uint32 dirty_data_size(const SpriteRendererComponent* c);
+
+    // Copy component_size bytes per component into buffer.
+    void copy_new_data(SpriteRendererComponent* c, void* buffer);
     SpriteRendererComponentData create_data_from_buffer(void* buffer, uint32 num);
 }
 
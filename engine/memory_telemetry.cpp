@@ -0,0 +1,150 @@
+#include "memory_telemetry.h"
+#include "renderer/renderer.h"
+#include <cstdio>
+#include <cstring>
+
+namespace bowtie
+{
+
+namespace memory_telemetry
+{
+
+void init(MemoryTelemetry* t)
+{
+    memset(t, 0, sizeof(MemoryTelemetry));
+}
+
+void add_allocator(MemoryTelemetry* t, const Allocator* allocator)
+{
+    Assert(t->num_allocators < memory_telemetry::max_allocators, "Too many allocators in memory telemetry, increase memory_telemetry::max_allocators");
+    auto at = t->allocators + t->num_allocators++;
+    memset(at, 0, sizeof(AllocatorTelemetry));
+    at->allocator = allocator;
+    at->_lifetime_allocations = allocator->lifetime_allocations;
+}
+
+void add_render_thread_snapshot(MemoryTelemetry* t, RenderThreadMemorySnapshot* snapshot, const Allocator* render_thread_allocator)
+{
+    add_allocator(t, render_thread_allocator);
+    auto at = t->allocators + t->num_allocators - 1;
+    at->snapshot = snapshot;
+    std::lock_guard<std::mutex> lock(snapshot->mutex);
+    at->_lifetime_allocations = snapshot->lifetime_allocations;
+    t->render_thread_snapshot = snapshot;
+}
+
+void set_renderer(MemoryTelemetry* t, const Renderer* renderer)
+{
+    t->renderer = renderer;
+}
+
+void publish_render_thread_snapshot(RenderThreadMemorySnapshot* snapshot, const Allocator* render_thread_allocator)
+{
+    std::lock_guard<std::mutex> lock(snapshot->mutex);
+    snapshot->render_thread_memory = memory::usage(&RenderThreadMemory);
+    snapshot->allocator.used = render_thread_allocator->total_allocated;
+    snapshot->allocator.peak = render_thread_allocator->peak_allocated;
+    snapshot->live_allocations = render_thread_allocator->total_allocations;
+    snapshot->lifetime_allocations = render_thread_allocator->lifetime_allocations;
+}
+
+void set_log_sink(MemoryTelemetry* t, MemoryLogSink sink, uint32 interval)
+{
+    t->log_sink = sink;
+    t->log_interval = interval;
+}
+
+void sample(MemoryTelemetry* t)
+{
+    ++t->frame;
+
+    for (uint32 i = 0; i < t->num_allocators; ++i)
+    {
+        auto at = t->allocators + i;
+        uint64 lifetime_allocations;
+
+        if (at->snapshot != nullptr)
+        {
+            std::lock_guard<std::mutex> lock(at->snapshot->mutex);
+            at->usage = at->snapshot->allocator;
+            at->live_allocations = at->snapshot->live_allocations;
+            lifetime_allocations = at->snapshot->lifetime_allocations;
+        }
+        else
+        {
+            auto a = at->allocator;
+            at->usage.used = a->total_allocated;
+            at->usage.peak = a->peak_allocated;
+            at->live_allocations = a->total_allocations;
+            lifetime_allocations = a->lifetime_allocations;
+        }
+
+        at->allocations_previous_frame = lifetime_allocations - at->_lifetime_allocations;
+        at->_lifetime_allocations = lifetime_allocations;
+    }
+
+    t->main_thread_memory = memory::usage(&MainThreadMemory);
+
+    if (t->render_thread_snapshot != nullptr)
+    {
+        std::lock_guard<std::mutex> lock(t->render_thread_snapshot->mutex);
+        t->render_thread_memory = t->render_thread_snapshot->render_thread_memory;
+    }
+
+    t->num_temp_memory = temp_memory::stats(t->temp_memory, temp_memory::max_threads);
+    temp_memory::shared_stats(&t->shared_temp_memory);
+
+    if (t->renderer != nullptr)
+    {
+        t->num_queue_stalls = t->renderer->render_interface.num_queue_stalls;
+        t->queue_stall_time = t->renderer->render_interface.queue_stall_time;
+        t->state_changes_issued = t->renderer->previous_frame_state_changes_issued.load(std::memory_order_relaxed);
+        t->state_changes_skipped = t->renderer->previous_frame_state_changes_skipped.load(std::memory_order_relaxed);
+    }
+
+    if (t->log_sink != nullptr && t->log_interval != 0 && t->frame % t->log_interval == 0)
+        log(t, t->log_sink);
+}
+
+void log(const MemoryTelemetry* t, MemoryLogSink sink)
+{
+    char line[256];
+    snprintf(line, sizeof(line), "memory telemetry, frame %llu", t->frame);
+    sink(line);
+    snprintf(line, sizeof(line), "  main thread memory: %llu used, %llu peak, %llu capacity", t->main_thread_memory.used, t->main_thread_memory.peak, t->main_thread_memory.capacity);
+    sink(line);
+    snprintf(line, sizeof(line), "  render thread memory: %llu used, %llu peak, %llu capacity", t->render_thread_memory.used, t->render_thread_memory.peak, t->render_thread_memory.capacity);
+    sink(line);
+
+    for (uint32 i = 0; i < t->num_temp_memory; ++i)
+    {
+        auto s = t->temp_memory + i;
+        snprintf(line, sizeof(line), "  temp memory region %u: %llu live, %llu peak live, %llu capacity, %llu previous frame, %llu peak frame",
+            i, s->live.used, s->live.peak, s->live.capacity, s->previous_frame_bytes, s->peak_frame_bytes);
+        sink(line);
+    }
+
+    auto shared = &t->shared_temp_memory;
+    snprintf(line, sizeof(line), "  shared temp memory: %llu head, %llu peak head, %llu capacity, %llu since previous sample, %llu peak between samples",
+        shared->live.used, shared->live.peak, shared->live.capacity, shared->previous_frame_bytes, shared->peak_frame_bytes);
+    sink(line);
+
+    for (uint32 i = 0; i < t->num_allocators; ++i)
+    {
+        auto at = t->allocators + i;
+        snprintf(line, sizeof(line), "  %s: %llu used, %llu peak, %u live allocations, %llu allocations previous frame",
+            at->allocator->name, at->usage.used, at->usage.peak, at->live_allocations, at->allocations_previous_frame);
+        sink(line);
+    }
+
+    if (t->renderer != nullptr)
+    {
+        snprintf(line, sizeof(line), "  renderer: %llu command queue stalls, %llu us stalled, %u state changes issued and %u skipped previous frame",
+            t->num_queue_stalls, t->queue_stall_time, t->state_changes_issued, t->state_changes_skipped);
+        sink(line);
+    }
+}
+
+} // namespace memory_telemetry
+
+} // namespace bowtie
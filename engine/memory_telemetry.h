@@ -0,0 +1,79 @@
+#pragma once
+
+#include <base/memory.h>
+#include <mutex>
+
+namespace bowtie
+{
+
+struct Renderer;
+typedef void (*MemoryLogSink)(const char* line);
+
+namespace memory_telemetry
+{
+    static const uint32 max_allocators = 8;
+}
+
+// Counters owned by the render thread. The render thread copies them here at the end of each of its
+// frames, so that the main thread can sample them without racing it.
+struct RenderThreadMemorySnapshot
+{
+    std::mutex mutex;
+    MemoryUsage render_thread_memory;
+    MemoryUsage allocator;
+    uint32 live_allocations;
+    uint64 lifetime_allocations;
+};
+
+struct AllocatorTelemetry
+{
+    const Allocator* allocator;
+    RenderThreadMemorySnapshot* snapshot; // Read instead of the allocator if it's used by the render thread.
+    MemoryUsage usage;
+    uint32 live_allocations;
+    uint64 allocations_previous_frame;
+    uint64 _lifetime_allocations;
+};
+
+// Memory usage of everything the engine knows about, sampled once per frame.
+struct MemoryTelemetry
+{
+    uint64 frame;
+    AllocatorTelemetry allocators[memory_telemetry::max_allocators];
+    uint32 num_allocators;
+    MemoryUsage main_thread_memory;
+    MemoryUsage render_thread_memory;
+    TempMemoryStats temp_memory[temp_memory::max_threads];
+    uint32 num_temp_memory;
+    TempMemoryStats shared_temp_memory;
+    RenderThreadMemorySnapshot* render_thread_snapshot;
+
+    // Sampled from the renderer. Queue stalls are totals, state changes are of the previous rendered frame.
+    const Renderer* renderer;
+    uint64 num_queue_stalls;
+    uint64 queue_stall_time; // In microseconds.
+    uint32 state_changes_issued;
+    uint32 state_changes_skipped;
+    MemoryLogSink log_sink;
+    uint32 log_interval; // In frames, 0 disables logging.
+};
+
+namespace memory_telemetry
+{
+    void init(MemoryTelemetry* t);
+    void add_allocator(MemoryTelemetry* t, const Allocator* allocator);
+
+    // Samples render thread memory and the render thread's allocator from the snapshot.
+    void add_render_thread_snapshot(MemoryTelemetry* t, RenderThreadMemorySnapshot* snapshot, const Allocator* render_thread_allocator);
+
+    // Also samples the command queue stalls and state change counters of renderer.
+    void set_renderer(MemoryTelemetry* t, const Renderer* renderer);
+
+    // Called by the render thread.
+    void publish_render_thread_snapshot(RenderThreadMemorySnapshot* snapshot, const Allocator* render_thread_allocator);
+    void set_log_sink(MemoryTelemetry* t, MemoryLogSink sink, uint32 interval);
+    void sample(MemoryTelemetry* t);
+    void log(const MemoryTelemetry* t, MemoryLogSink sink);
+}
+
+}
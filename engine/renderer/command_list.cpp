@@ -0,0 +1,93 @@
+#include "command_list.h"
+#include <base/memory.h>
+#include <cstring>
+
+namespace bowtie
+{
+
+namespace internal
+{
+
+const uint32 command_list_initial_capacity = 16384;
+const uint32 command_list_initial_entries = 256;
+
+void grow_packets(CommandList* cl, uint32 min_capacity)
+{
+    auto capacity = cl->capacity == 0 ? command_list_initial_capacity : cl->capacity * 2;
+
+    while (capacity < min_capacity)
+        capacity *= 2;
+
+    auto packets = (uint8*)cl->allocator->alloc_raw(capacity, renderer_command::alignment);
+    memcpy(packets, cl->packets, cl->size);
+    cl->allocator->dealloc(cl->packets);
+    cl->packets = packets;
+    cl->capacity = capacity;
+}
+
+void grow_entries(CommandList* cl)
+{
+    auto capacity = cl->entries_capacity == 0 ? command_list_initial_entries : cl->entries_capacity * 2;
+    auto entries = (CommandListEntry*)cl->allocator->alloc_raw(sizeof(CommandListEntry) * capacity);
+    memcpy(entries, cl->entries, sizeof(CommandListEntry) * cl->num_entries);
+    cl->allocator->dealloc(cl->entries);
+    cl->entries = entries;
+    cl->entries_capacity = capacity;
+}
+
+} // namespace internal
+
+namespace command_list
+{
+
+void init(CommandList* cl, Allocator* allocator)
+{
+    memset(cl, 0, sizeof(CommandList));
+    cl->allocator = allocator;
+}
+
+void deinit(CommandList* cl)
+{
+    cl->allocator->dealloc(cl->packets);
+    cl->allocator->dealloc(cl->entries);
+}
+
+void reset(CommandList* cl)
+{
+    cl->size = 0;
+    cl->num_entries = 0;
+}
+
+RendererCommand* record(CommandList* cl, uint64 sort_key, RendererCommand::Type type, uint32 data_size, uint32 dynamic_data_size)
+{
+    auto size = renderer_command::padded_size(sizeof(RendererCommand)) + renderer_command::padded_size(data_size) + renderer_command::padded_size(dynamic_data_size);
+
+    if (cl->size + size > cl->capacity)
+        internal::grow_packets(cl, cl->size + size);
+
+    if (cl->num_entries == cl->entries_capacity)
+        internal::grow_entries(cl);
+
+    auto entry = cl->entries + cl->num_entries++;
+    entry->sort_key = sort_key;
+    entry->offset = cl->size;
+
+    auto command = (RendererCommand*)(cl->packets + cl->size);
+    command->type = type;
+    command->size = size;
+    command->data_size = data_size;
+    command->dynamic_data_size = dynamic_data_size;
+    command->external_dynamic_data = nullptr;
+    cl->size += size;
+    return command;
+}
+
+void record(CommandList* cl, uint64 sort_key, RendererCommand::Type type, const void* data, uint32 data_size)
+{
+    auto command = record(cl, sort_key, type, data_size, 0);
+    memcpy(renderer_command::data(command), data, data_size);
+}
+
+} // namespace command_list
+
+} // namespace bowtie
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "renderer_command.h"
+
+namespace bowtie
+{
+
+struct Allocator;
+
+struct CommandListEntry
+{
+    uint64 sort_key;
+    uint32 offset;
+};
+
+// Renderer command packets recorded by one thread, to be merged into the command queue in sort key
+// order by render_interface::submit_command_lists. The packets have the same layout as in the queue.
+struct CommandList
+{
+    Allocator* allocator;
+    uint8* packets;
+    uint32 size;
+    uint32 capacity;
+    CommandListEntry* entries;
+    uint32 num_entries;
+    uint32 entries_capacity;
+};
+
+namespace command_list
+{
+    void init(CommandList* cl, Allocator* allocator);
+    void deinit(CommandList* cl);
+    void reset(CommandList* cl);
+
+    // Returned packet is valid until the next command is recorded. Dynamic data is always inline.
+    RendererCommand* record(CommandList* cl, uint64 sort_key, RendererCommand::Type type, uint32 data_size, uint32 dynamic_data_size);
+    void record(CommandList* cl, uint64 sort_key, RendererCommand::Type type, const void* data, uint32 data_size);
+
+    // Commands with equal keys keep the order they were recorded in. Higher bits sort first:
+    // view (see render_interface::next_view) in bits 48-63, layer in 32-47, material in 0-31.
+    inline uint64 sort_key(uint32 view, uint32 layer, uint32 material)
+    {
+        return (uint64(view & 0xffff) << 48) | (uint64(layer & 0xffff) << 32) | uint64(material);
+    }
+}
+
+}
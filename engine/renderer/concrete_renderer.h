@@ -15,6 +15,7 @@ struct RenderWorld;
 struct ShaderResourceData;
 struct TextureResourceData;
 struct Rect;
+struct RenderResourceTable;
 struct Vector2u;
 
 struct ConcreteRenderer
@@ -26,11 +27,15 @@ struct ConcreteRenderer
     RenderResource (*create_render_target)(const RenderTexture* texture);
     void (*destroy_render_target)(RenderResource render_target);
     uint32 (*get_uniform_location)(RenderResource shader, const char* name);
+    uint32 (*get_material_uniform_buffer_size)(RenderResource shader);
+    uint32 (*get_material_uniform_buffer_offset)(RenderResource shader, const char* name);
+    void (*destroy_uniform_buffer)(RenderResource uniform_buffer);
     RenderResource (*create_texture)(PixelFormat pf, const Vector2u* resolution, void* data);
     void (*destroy_texture)(RenderResource texture);
     RenderResource (*create_shader)(const char* vertex_source, const char* fragment_source);
     void (*destroy_shader)(RenderResource handle);
     RenderResource (*update_shader)(const RenderResource* shader, const char* vertex_source, const char* fragment_source);
+    void (*destroy_gpu_sprites)(RenderResource gpu_sprites);
         
     // State setters
     void (*resize)(const Vector2u* size, RenderTarget* render_targets);
@@ -39,8 +44,11 @@ struct ConcreteRenderer
 
     // Drawing
     void (*clear)();
-    void (*draw)(const Rect* view, const RenderWorld* render_world, const Vector2u* resolution, real32 time, const RenderResource* resource_table);
+    void (*draw)(const Rect* view, RenderWorld* render_world, const Vector2u* resolution, real32 time, const RenderResourceTable* resource_table);
     void (*combine_rendered_worlds)(RenderResource rendered_worlds_combining_shader, RenderWorld** rendered_worlds, uint32 num_rendered_worlds);
+
+    // Statistics of the previous frame, valid after combine_rendered_worlds.
+    void (*state_change_stats)(uint32* num_issued, uint32* num_skipped);
 };
 
 }
@@ -1,26 +1,16 @@
 #pragma once
 
-#include <condition_variable>
-#include <mutex>
-
 namespace bowtie
 {
 
-struct RenderFence
-{
-    std::condition_variable fence_processed;
-    std::mutex mutex;
-    bool processed;
-    
-    RenderFence()
-    {
-        processed = false;
-    }
+// Fences are numbered in dispatch order. The render thread raises them in the same order, so a
+// fence is reached once the last raised fence is at least as large.
+typedef uint64 RenderFence;
 
-    RenderFence(const RenderFence&)
-    {
-        processed = false;
-    }
-};
+namespace render_fence
+{
+    // Times a waiter checks the fence before it blocks.
+    static const uint32 spin_count = 4000;
+}
 
-}
\ No newline at end of file
+}
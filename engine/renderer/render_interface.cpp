@@ -3,8 +3,11 @@
 
 #include <condition_variable>
 #include <mutex>
+#include <thread>
+#include <chrono>
 
 #include <base/memory.h>
+#include <base/vector.h>
 
 #include "../image.h"
 #include "../material.h"
@@ -13,6 +16,8 @@
 #include "../texture.h"
 #include "../world.h"
 #include <base/concurrent_ring_buffer.h>
+#include <base/thread_local.h>
+#include <algorithm>
 
 namespace bowtie
 {
@@ -20,97 +25,267 @@ namespace bowtie
 namespace internal
 {
 
-RendererCommand create_or_update_resource_renderer_command(RenderResourceData* resource, void* dynamic_data, uint32 dynamic_data_size, RendererCommand::Type command_type)
+uint32 resource_data_size(RenderResourceData::Type type, RendererCommand::Type command_type)
 {
-    RendererCommand rc;
+    if (type == RenderResourceData::SpriteRenderer && command_type == RendererCommand::UpdateResource)
+        return sizeof(UpdateSpriteRendererData);
 
-    auto copied_resource = (RenderResourceData*)temp_memory::alloc_raw(sizeof(RenderResourceData));
-    memcpy(copied_resource, resource, sizeof(RenderResourceData));
-    rc.data = copied_resource;
-    rc.type = command_type;
+    switch (type)
+    {
+    case RenderResourceData::RenderMaterial: return sizeof(MaterialResourceData);
+    case RenderResourceData::Shader: return sizeof(ShaderResourceData);
+    case RenderResourceData::Texture: return sizeof(TextureResourceData);
+    case RenderResourceData::SpriteRenderer: return sizeof(CreateSpriteRendererData);
+    case RenderResourceData::World: return sizeof(RenderWorldResourceData);
+    default: Error("Unknown resource data type."); return 0;
+    }
+}
 
-    switch (resource->type)
+void notify_commands_exist(RenderInterface* ri)
+{
     {
-    case RenderResourceData::RenderMaterial:
-        copied_resource->data = temp_memory::alloc_raw(sizeof(MaterialResourceData));
-        memcpy(copied_resource->data, resource->data, sizeof(MaterialResourceData));
-        break;
-    case RenderResourceData::Shader:
-        copied_resource->data = temp_memory::alloc_raw(sizeof(ShaderResourceData));
-        memcpy(copied_resource->data, resource->data, sizeof(ShaderResourceData));
-        break;
-    case RenderResourceData::Texture:
-        copied_resource->data = temp_memory::alloc_raw(sizeof(TextureResourceData));
-        memcpy(copied_resource->data, resource->data, sizeof(TextureResourceData));
-        break;
-    case RenderResourceData::SpriteRenderer:
-        copied_resource->data = temp_memory::alloc_raw(sizeof(CreateSpriteRendererData));
-        memcpy(copied_resource->data, resource->data, sizeof(CreateSpriteRendererData));
-        break;
-    case RenderResourceData::World:
-        copied_resource->data = temp_memory::alloc_raw(sizeof(RenderWorldResourceData));
-        memcpy(copied_resource->data, resource->data, sizeof(RenderWorldResourceData));
-        break;
-    default:
-        Error("Unknown resource data type.");
-        break;
+        std::lock_guard<std::mutex> unprocessed_commands_exists_lock(*ri->_unprocessed_commands_exist_mutex);
+        *ri->_unprocessed_commands_exist = true;
     }
 
-    rc.dynamic_data = dynamic_data;
-    rc.dynamic_data_size = dynamic_data_size;
+    ri->_wait_for_unprocessed_commands_to_exist->notify_all();
+}
 
-    return rc;
+void wait_for_queue_space(RenderInterface* ri, uint32 num_elements)
+{
+    auto queue = ri->_unprocessed_commands;
+
+    if (concurrent_ring_buffer::fits_n(queue, num_elements))
+        return;
+
+    auto stall_start = std::chrono::high_resolution_clock::now();
+
+    // Commands may be committed without notifying, as when merging command lists. Wake the render
+    // thread so that it frees the space.
+    notify_commands_exist(ri);
+
+    {
+        std::unique_lock<std::mutex> lock(ri->_queue_space_mutex);
+        ri->_waiting_for_queue_space = true;
+
+        // Pairs with the fence in signal_queue_space: either the render thread sees the flag, or
+        // this thread sees the space it freed.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        ri->_queue_space_available.wait(lock, [&]{ return concurrent_ring_buffer::fits_n(queue, num_elements); });
+        ri->_waiting_for_queue_space = false;
+    }
+
+    ++ri->num_queue_stalls;
+    ri->queue_stall_time += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - stall_start).count();
 }
 
-RendererCommand create_command(RendererCommand::Type type)
+// Returns space for num_elements contiguous elements at the write head of the queue. If they don't
+// fit before the queue wraps, the rest of it is filled with a padding packet.
+RendererCommand* reserve_packet(RenderInterface* ri, uint32 num_elements)
 {
-    RendererCommand command;
-    memset(&command, 0, sizeof(RendererCommand));
-    command.type = type;
+    auto queue = ri->_unprocessed_commands;
+    Assert(num_elements <= queue->size / 2, "Renderer command is too large for the command queue");
+    auto until_wrap = concurrent_ring_buffer::elements_until_wrap(queue);
 
-    switch (type)
+    if (until_wrap < num_elements)
     {
-    case RendererCommand::SetUniformValue:
-        command.data = temp_memory::alloc_raw(sizeof(SetUniformValueData));
-        break;
+        wait_for_queue_space(ri, until_wrap);
+        auto padding = (RendererCommand*)concurrent_ring_buffer::write_pointer(queue);
+        padding->type = RendererCommand::Padding;
+        padding->size = until_wrap * renderer_command::alignment;
+        concurrent_ring_buffer::commit_n(queue, until_wrap);
     }
 
+    wait_for_queue_space(ri, num_elements);
+    return (RendererCommand*)concurrent_ring_buffer::write_pointer(queue);
+}
+
+RendererCommand* begin_command(RenderInterface* ri, RendererCommand::Type type, uint32 data_size, uint32 dynamic_data_size)
+{
+    auto inline_dynamic_data = dynamic_data_size <= renderer_command::max_inline_dynamic_data_size;
+    auto size = renderer_command::padded_size(sizeof(RendererCommand)) + renderer_command::padded_size(data_size)
+        + (inline_dynamic_data ? renderer_command::padded_size(dynamic_data_size) : 0);
+    auto command = reserve_packet(ri, size / renderer_command::alignment);
+    command->type = type;
+    command->size = size;
+    command->data_size = data_size;
+    command->dynamic_data_size = dynamic_data_size;
+    command->external_dynamic_data = inline_dynamic_data ? nullptr : temp_memory::alloc_raw(dynamic_data_size);
     return command;
 }
 
-void dispatch(RenderInterface* ri, const RendererCommand* command)
+void end_command(RenderInterface* ri, RendererCommand* command)
+{
+    concurrent_ring_buffer::commit_n(ri->_unprocessed_commands, command->size / renderer_command::alignment);
+    notify_commands_exist(ri);
+}
+
+// The specific resource data is stored right after the RenderResourceData, which points to it.
+RendererCommand* begin_resource_command(RenderInterface* ri, const RenderResourceData* resource, uint32 dynamic_data_size, RendererCommand::Type command_type)
 {
-    if (!concurrent_ring_buffer::fits_one(ri->_unprocessed_commands))
-        render_interface::wait_until_idle(ri);
-    
-    concurrent_ring_buffer::write_one(ri->_unprocessed_commands, command);
+    auto specific_data_size = resource_data_size(resource->type, command_type);
+    auto command = begin_command(ri, command_type, sizeof(RenderResourceData) + specific_data_size, dynamic_data_size);
+    auto data = (RenderResourceData*)renderer_command::data(command);
+    data->type = resource->type;
+    data->data = memory::pointer_add(data, sizeof(RenderResourceData));
+    memcpy(data->data, resource->data, specific_data_size);
+    return command;
+}
 
+void dispatch_resource(RenderInterface* ri, const RenderResourceData* resource, const void* dynamic_data, uint32 dynamic_data_size, RendererCommand::Type command_type)
+{
+    auto command = begin_resource_command(ri, resource, dynamic_data_size, command_type);
+    memcpy(renderer_command::dynamic_data(command), dynamic_data, dynamic_data_size);
+    end_command(ri, command);
+}
+
+void dispatch(RenderInterface* ri, RendererCommand::Type type, const void* data, uint32 data_size, const void* dynamic_data, uint32 dynamic_data_size)
+{
+    auto command = begin_command(ri, type, data_size, dynamic_data_size);
+    memcpy(renderer_command::data(command), data, data_size);
+    memcpy(renderer_command::dynamic_data(command), dynamic_data, dynamic_data_size);
+    end_command(ri, command);
+}
+
+RenderResourceHandle create_handle(RenderInterface* ri)
+{
+    auto generations = &ri->_handle_generations;
+
+    if (ri->_free_handle_indices.size > 0)
     {
-        std::lock_guard<std::mutex> unprocessed_commands_exists_lock(*ri->_unprocessed_commands_exist_mutex);
-        *ri->_unprocessed_commands_exist = true;
+        auto index = *vector::last(&ri->_free_handle_indices);
+        vector::pop(&ri->_free_handle_indices);
+        return render_resource_handle::create(index, (*generations)[index]);
     }
 
-    ri->_wait_for_unprocessed_commands_to_exist->notify_all();
+    auto index = generations->size;
+    Assert(index < render_resource_handle::max_handles, "Out of render resource handles!");
+    vector::push(generations, (uint16)0);
+    return render_resource_handle::create(index, 0);
 }
 
-void create_resource(RenderInterface* ri, RenderResourceData* resource, void* dynamic_data, uint32 dynamic_data_size)
+void free_handle(RenderInterface* ri, RenderResourceHandle handle)
 {
-    auto command = create_or_update_resource_renderer_command(resource, dynamic_data, dynamic_data_size, RendererCommand::LoadResource);
-    dispatch(ri, &command);
+    auto index = render_resource_handle::index(handle);
+    auto generations = &ri->_handle_generations;
+    Assert(index > 0 && index < generations->size, "Trying to free render resource handle which is out of range.");
+    Assert(render_resource_handle::generation(handle) == (*generations)[index], "Trying to free stale render resource handle.");
+    (*generations)[index] = ((*generations)[index] + 1) & render_resource_handle::generation_mask;
+    vector::push(&ri->_free_handle_indices, index);
 }
 
-void update_resource(RenderInterface* ri, RenderResourceData* resource, void* dynamic_data, uint32 dynamic_data_size)
+std::atomic<uint32> num_command_list_threads;
+ThreadLocal uint32 command_list_thread_index_plus_one;
+
+struct SubmittedCommand
 {
-    auto command = create_or_update_resource_renderer_command(resource, dynamic_data, dynamic_data_size, RendererCommand::UpdateResource);
-    dispatch(ri, &command);
+    uint64 sort_key;
+    uint32 list;
+    uint32 entry;
+};
+
+bool submitted_command_less(const SubmittedCommand& a, const SubmittedCommand& b)
+{
+    if (a.sort_key != b.sort_key)
+        return a.sort_key < b.sort_key;
+
+    if (a.list != b.list)
+        return a.list < b.list;
+
+    return a.entry < b.entry;
+}
+
+// Consecutive destroys of the same type and world are dispatched as one command.
+void dispatch_pending_destroys(RenderInterface* ri)
+{
+    auto pending = &ri->_pending_destroys;
+
+    if (pending->size == 0)
+        return;
+
+    auto handles = (RenderResourceHandle*)temp_memory::alloc_raw(sizeof(RenderResourceHandle) * pending->size);
+    uint32 i = 0;
+
+    while (i < pending->size)
+    {
+        DestroyResourceData drd;
+        drd.type = (*pending)[i].type;
+        drd.world = (*pending)[i].world;
+        drd.num = 0;
+
+        while (i < pending->size && (*pending)[i].type == drd.type && (*pending)[i].world == drd.world)
+            handles[drd.num++] = (*pending)[i++].handle;
+
+        dispatch(ri, RendererCommand::DestroyResource, &drd, sizeof(DestroyResourceData), handles, sizeof(RenderResourceHandle) * drd.num);
+    }
+
+    for (uint32 j = 0; j < pending->size; ++j)
+        free_handle(ri, (*pending)[j].handle);
+
+    vector::clear(pending);
+}
+
+void submit_command_lists(RenderInterface* ri)
+{
+    uint32 num_commands = 0;
+    auto num_lists = num_command_list_threads.load();
+
+    for (uint32 i = 0; i < num_lists; ++i)
+        num_commands += ri->_command_lists[i].num_entries;
+
+    if (num_commands == 0)
+    {
+        dispatch_pending_destroys(ri);
+        return;
+    }
+
+    auto commands = (SubmittedCommand*)temp_memory::alloc_raw(sizeof(SubmittedCommand) * num_commands);
+    uint32 n = 0;
+
+    for (uint32 i = 0; i < num_lists; ++i)
+    {
+        auto cl = ri->_command_lists + i;
+
+        for (uint32 j = 0; j < cl->num_entries; ++j)
+        {
+            commands[n].sort_key = cl->entries[j].sort_key;
+            commands[n].list = i;
+            commands[n].entry = j;
+            ++n;
+        }
+    }
+
+    std::sort(commands, commands + num_commands, submitted_command_less);
+
+    for (uint32 i = 0; i < num_commands; ++i)
+    {
+        auto cl = ri->_command_lists + commands[i].list;
+        auto recorded = (RendererCommand*)(cl->packets + cl->entries[commands[i].entry].offset);
+        auto command = begin_command(ri, recorded->type, recorded->data_size, recorded->dynamic_data_size);
+        memcpy(renderer_command::data(command), renderer_command::data(recorded), recorded->data_size);
+        memcpy(renderer_command::dynamic_data(command), renderer_command::dynamic_data(recorded), recorded->dynamic_data_size);
+        concurrent_ring_buffer::commit_n(ri->_unprocessed_commands, command->size / renderer_command::alignment);
+    }
+
+    notify_commands_exist(ri);
+
+    for (uint32 i = 0; i < num_lists; ++i)
+        command_list::reset(ri->_command_lists + i);
+
+    ri->_num_views = 0;
+    dispatch_pending_destroys(ri);
 }
 
-RenderResourceHandle create_handle(RenderResourceHandle* free_handles, uint32* num_free_handles)
+void destroy_resources(RenderInterface* ri, RenderResourceData::Type type, RenderResourceHandle world, const RenderResourceHandle* handles, uint32 num)
 {
-    Assert(*num_free_handles > 0, "Out of render resource handles!");
-    RenderResourceHandle handle = free_handles[*num_free_handles - 1];
-    --*num_free_handles;
-    return handle;
+    for (uint32 i = 0; i < num; ++i)
+    {
+        PendingResourceDestroy prd;
+        prd.type = type;
+        prd.world = world;
+        prd.handle = handles[i];
+        vector::push(&ri->_pending_destroys, prd);
+    }
 }
 
 } // namespace internal
@@ -118,31 +293,42 @@ RenderResourceHandle create_handle(RenderResourceHandle* free_handles, uint32* n
 namespace render_interface
 {
 
-void init(RenderInterface* ri, ConcurrentRingBuffer* unprocessed_commands, bool* unprocessed_commands_exist,
+void init(RenderInterface* ri, Allocator* allocator, ConcurrentRingBuffer* unprocessed_commands, bool* unprocessed_commands_exist,
           std::mutex* unprocessed_commands_exist_mutex, std::condition_variable* wait_for_unprocessed_commands_to_exist)
 {
+    ri->allocator = allocator;
     ri->_unprocessed_commands = unprocessed_commands;
     ri->_unprocessed_commands_exist = unprocessed_commands_exist;
     ri->_unprocessed_commands_exist_mutex = unprocessed_commands_exist_mutex;
     ri->_wait_for_unprocessed_commands_to_exist = wait_for_unprocessed_commands_to_exist;
-    auto num_handles = render_resource_handle::num;
-    
-    for (uint32 handle = num_handles; handle > 0; --handle)
-        ri->_free_handles[num_handles - handle] = handle;
 
-    ri->num_free_handles = num_handles;
+    vector::init(&ri->_handle_generations, allocator);
+    vector::init(&ri->_free_handle_indices, allocator);
+    vector::init(&ri->_pending_destroys, allocator);
+
+    // Index 0 is reserved so that no valid handle equals NotInitialized.
+    vector::push(&ri->_handle_generations, (uint16)0);
+    ri->_waiting_for_queue_space = false;
+    memset(ri->_command_lists, 0, sizeof(CommandList) * max_command_list_threads);
+    ri->_num_views = 0;
+    ri->num_queue_stalls = 0;
+    ri->queue_stall_time = 0;
+    ri->frames_in_flight = 2;
+    ri->_submitted_frame = 0;
+    ri->_completed_frame = 0;
+    ri->_last_fence = 0;
+    ri->_raised_fence = 0;
+    ri->_num_fence_waiters = 0;
 }
 
 RenderResourceHandle create_handle(RenderInterface* ri)
 {
-    return internal::create_handle(ri->_free_handles, &ri->num_free_handles);
+    return internal::create_handle(ri);
 }
 
 void free_handle(RenderInterface* ri, RenderResourceHandle handle)
 {
-    Assert(handle < render_resource_handle::num, "Trying to free render resource handle with a higher value than render_resource_handle::num.");
-    ri->_free_handles[ri->num_free_handles] = handle;
-    ++ri->num_free_handles;
+    internal::free_handle(ri, handle);
 }
 
 void create_texture(RenderInterface* ri, Texture* texture)
@@ -151,34 +337,44 @@ void create_texture(RenderInterface* ri, Texture* texture)
     auto image = texture->image;
     auto texture_resource = render_resource_data::create(RenderResourceData::Texture);
     auto trd = TextureResourceData();
-    trd.handle = internal::create_handle(ri->_free_handles, &ri->num_free_handles);
+    trd.handle = internal::create_handle(ri);
     trd.resolution = image->resolution;
     trd.texture_data_dynamic_data_offset = 0;
     trd.texture_data_size = image->data_size;
     trd.pixel_format = image->pixel_format;
     texture_resource.data = &trd;
-    internal::create_resource(ri, &texture_resource, image->data, image->data_size);
+    internal::dispatch_resource(ri, &texture_resource, image->data, image->data_size, RendererCommand::LoadResource);
     texture->render_handle = trd.handle;
 }
 
+RendererCommand* begin_create_resource(RenderInterface* ri, const RenderResourceData* resource, uint32 dynamic_data_size)
+{
+    return internal::begin_resource_command(ri, resource, dynamic_data_size, RendererCommand::LoadResource);
+}
+
+RendererCommand* begin_update_resource(RenderInterface* ri, const RenderResourceData* resource, uint32 dynamic_data_size)
+{
+    return internal::begin_resource_command(ri, resource, dynamic_data_size, RendererCommand::UpdateResource);
+}
+
 void create_resource(RenderInterface* ri, RenderResourceData* resource, void* dynamic_data, uint32 dynamic_data_size)
 {
-    internal::create_resource(ri, resource, dynamic_data, dynamic_data_size);
+    internal::dispatch_resource(ri, resource, dynamic_data, dynamic_data_size, RendererCommand::LoadResource);
 }
 
 void update_resource(RenderInterface* ri, RenderResourceData* resource, void* dynamic_data, uint32 dynamic_data_size)
 {
-    internal::update_resource(ri, resource, dynamic_data, dynamic_data_size);
+    internal::dispatch_resource(ri, resource, dynamic_data, dynamic_data_size, RendererCommand::UpdateResource);
 }
 
 void create_resource(RenderInterface* ri, RenderResourceData* resource)
 {
-    internal::create_resource(ri, resource, nullptr, 0);
+    internal::dispatch_resource(ri, resource, nullptr, 0, RendererCommand::LoadResource);
 }
 
 void update_resource(RenderInterface* ri, RenderResourceData* resource)
 {
-    internal::update_resource(ri, resource, nullptr, 0);
+    internal::dispatch_resource(ri, resource, nullptr, 0, RendererCommand::UpdateResource);
 }
 
 void create_render_world(RenderInterface* ri, World* world)
@@ -186,58 +382,188 @@ void create_render_world(RenderInterface* ri, World* world)
     Assert(world->render_handle == NotInitialized, "Render world is already initialized");
     auto render_world_data = render_resource_data::create(RenderResourceData::World);
     RenderWorldResourceData rwrd;
-    rwrd.handle = internal::create_handle(ri->_free_handles, &ri->num_free_handles);
+    rwrd.handle = internal::create_handle(ri);
     render_world_data.data = &rwrd;
     world->render_handle = rwrd.handle;
-    internal::create_resource(ri, &render_world_data, nullptr, 0);
+    internal::dispatch_resource(ri, &render_world_data, nullptr, 0, RendererCommand::LoadResource);
 }
 
-RendererCommand create_command(RendererCommand::Type type)
+void destroy_resources(RenderInterface* ri, RenderResourceData::Type type, RenderResourceHandle world, const RenderResourceHandle* handles, uint32 num)
 {
-    return internal::create_command(type);
+    Assert((type == RenderResourceData::SpriteRenderer) == (world != NotInitialized), "Sprite renderers, and only they, are destroyed with a world handle.");
+    internal::destroy_resources(ri, type, world, handles, num);
 }
 
-void dispatch(RenderInterface* ri, RendererCommand* command)
+void destroy_resource(RenderInterface* ri, RenderResourceData::Type type, RenderResourceHandle handle)
 {
-    internal::dispatch(ri, command);
+    destroy_resources(ri, type, NotInitialized, &handle, 1);
 }
 
-void dispatch(RenderInterface* ri, RendererCommand* command, void* dynamic_data, uint32 dynamic_data_size)
+void destroy_render_world(RenderInterface* ri, World* world)
 {
-    command->dynamic_data = temp_memory::alloc_raw(dynamic_data_size);
-    command->dynamic_data_size = dynamic_data_size;
-    memcpy(command->dynamic_data, dynamic_data, dynamic_data_size);
-    internal::dispatch(ri, command);
+    Assert(world->render_handle != NotInitialized, "Render world is not initialized");
+    auto sprites = &world->sprite_renderer_components;
+    auto num_created_sprites = sprites->header.num - component::num_new(&sprites->header);
+    internal::destroy_resources(ri, RenderResourceData::SpriteRenderer, world->render_handle, sprites->data.render_handle, num_created_sprites);
+    internal::destroy_resources(ri, RenderResourceData::World, NotInitialized, &world->render_handle, 1);
+    world->render_handle = NotInitialized;
+}
+
+RendererCommand* begin_command(RenderInterface* ri, RendererCommand::Type type, uint32 data_size, uint32 dynamic_data_size)
+{
+    return internal::begin_command(ri, type, data_size, dynamic_data_size);
+}
+
+void end_command(RenderInterface* ri, RendererCommand* command)
+{
+    internal::end_command(ri, command);
+}
+
+void dispatch(RenderInterface* ri, RendererCommand::Type type, const void* data, uint32 data_size, const void* dynamic_data, uint32 dynamic_data_size)
+{
+    internal::dispatch(ri, type, data, data_size, dynamic_data, dynamic_data_size);
+}
+
+void dispatch(RenderInterface* ri, RendererCommand::Type type, const void* data, uint32 data_size)
+{
+    internal::dispatch(ri, type, data, data_size, nullptr, 0);
+}
+
+RenderFence create_fence(RenderInterface* ri)
+{
+    auto fence = ++ri->_last_fence;
+    internal::dispatch(ri, RendererCommand::Fence, &fence, sizeof(RenderFence), nullptr, 0);
+    return fence;
 }
 
-RenderFence* create_fence(RenderInterface* ri)
+bool fence_reached(const RenderInterface* ri, RenderFence fence)
 {
-    auto fence_command = internal::create_command(RendererCommand::Fence);
-    fence_command.data = new(temp_memory::alloc_raw(sizeof(RenderFence), alignof(RenderFence))) RenderFence(); 
-    internal::dispatch(ri, &fence_command);
-    return (RenderFence*)fence_command.data;
+    return ri->_raised_fence.load(std::memory_order_acquire) >= fence;
 }
 
-void wait_for_fence(RenderFence* fence)
+void wait_for_fence(RenderInterface* ri, RenderFence fence)
 {
+    for (uint32 i = 0; i < render_fence::spin_count; ++i)
     {
-        std::unique_lock<std::mutex> lock(fence->mutex);
-        fence->fence_processed.wait(lock, [&fence] { return fence->processed; });
+        if (fence_reached(ri, fence))
+            return;
+
+        std::this_thread::yield();
     }
+
+    std::unique_lock<std::mutex> lock(ri->_fence_mutex);
+    ++ri->_num_fence_waiters;
+    ri->_fence_raised.wait(lock, [ri, fence] { return fence_reached(ri, fence); });
+    --ri->_num_fence_waiters;
 }
 
 void wait_until_idle(RenderInterface* ri)
 {
-    wait_for_fence(create_fence(ri));
+    wait_for_fence(ri, create_fence(ri));
+}
+
+void raise_fence(RenderInterface* ri, RenderFence fence)
+{
+    ri->_raised_fence.store(fence, std::memory_order_seq_cst);
+
+    // Waiters register under the mutex before checking the fence, so either they see the new value
+    // or they are counted here.
+    if (ri->_num_fence_waiters.load(std::memory_order_seq_cst) == 0)
+        return;
+
+    std::lock_guard<std::mutex> lock(ri->_fence_mutex);
+    ri->_fence_raised.notify_all();
+}
+
+CommandList* thread_command_list(RenderInterface* ri)
+{
+    if (internal::command_list_thread_index_plus_one == 0)
+    {
+        internal::command_list_thread_index_plus_one = internal::num_command_list_threads.fetch_add(1) + 1;
+        Assert(internal::command_list_thread_index_plus_one <= max_command_list_threads, "Too many threads recording render commands, increase render_interface::max_command_list_threads");
+    }
+
+    auto cl = ri->_command_lists + internal::command_list_thread_index_plus_one - 1;
+
+    if (cl->allocator == nullptr)
+        command_list::init(cl, ri->allocator);
+
+    return cl;
+}
+
+uint32 next_view(RenderInterface* ri)
+{
+    auto view = ri->_num_views.fetch_add(1);
+    Assert(view <= 0xffff, "Too many views drawn in one frame for the sort key");
+    return view;
+}
+
+void submit_command_lists(RenderInterface* ri)
+{
+    internal::submit_command_lists(ri);
+}
+
+void deinit(RenderInterface* ri)
+{
+    vector::deinit(&ri->_handle_generations);
+    vector::deinit(&ri->_free_handle_indices);
+    vector::deinit(&ri->_pending_destroys);
+
+    for (uint32 i = 0; i < max_command_list_threads; ++i)
+    {
+        if (ri->_command_lists[i].allocator != nullptr)
+            command_list::deinit(ri->_command_lists + i);
+    }
+}
+
+void set_frames_in_flight(RenderInterface* ri, uint32 frames_in_flight)
+{
+    Assert(frames_in_flight >= 1 && frames_in_flight <= max_frames_in_flight, "Frames in flight must be between 1 and render_interface::max_frames_in_flight");
+    ri->frames_in_flight = frames_in_flight;
+}
+
+void wait_for_frame_slot(RenderInterface* ri)
+{
+    auto has_slot = [ri] { return ri->_submitted_frame - ri->_completed_frame.load(std::memory_order_acquire) < ri->frames_in_flight; };
+
+    if (has_slot())
+        return;
+
+    std::unique_lock<std::mutex> lock(ri->_frame_completed_mutex);
+    ri->_frame_completed.wait(lock, has_slot);
+}
+
+uint64 submit_frame(RenderInterface* ri)
+{
+    return ++ri->_submitted_frame;
+}
+
+void complete_frame(RenderInterface* ri, uint64 frame_ticket)
+{
+    {
+        std::lock_guard<std::mutex> lock(ri->_frame_completed_mutex);
+        ri->_completed_frame.store(frame_ticket, std::memory_order_release);
+    }
+
+    ri->_frame_completed.notify_one();
+}
+
+void signal_queue_space(RenderInterface* ri)
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (!ri->_waiting_for_queue_space.load(std::memory_order_relaxed))
+        return;
+
+    std::lock_guard<std::mutex> lock(ri->_queue_space_mutex);
+    ri->_queue_space_available.notify_one();
 }
 
 void resize(RenderInterface* ri, const Vector2u* resolution)
 {
-    auto rd = (ResizeData*)temp_memory::alloc(sizeof(ResizeData));
-    rd->resolution = *resolution;
-    auto resize_command = internal::create_command(RendererCommand::Resize);
-    resize_command.data = rd;
-    dispatch(ri, &resize_command);
+    ResizeData rd;
+    rd.resolution = *resolution;
+    internal::dispatch(ri, RendererCommand::Resize, &rd, sizeof(ResizeData), nullptr, 0);
 }
 
 }
@@ -1,7 +1,11 @@
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
 #include <mutex>
 #include "renderer_command.h"
+#include "command_list.h"
+#include "render_fence.h"
 #include "render_resource_types.h"
 #include <base/collection_types.h>
 
@@ -11,9 +15,21 @@ namespace bowtie
 struct Allocator;
 struct World;
 struct Texture;
-struct RenderFence;
 struct ConcurrentRingBuffer;
 
+namespace render_interface
+{
+    static const uint32 max_command_list_threads = 8;
+    static const uint32 max_frames_in_flight = 3;
+}
+
+struct PendingResourceDestroy
+{
+    RenderResourceData::Type type;
+    RenderResourceHandle world; // The world sprite renderers are removed from.
+    RenderResourceHandle handle;
+};
+
 struct RenderInterface
 {
     Allocator* allocator;
@@ -21,28 +37,115 @@ struct RenderInterface
     bool* _unprocessed_commands_exist;
     std::mutex* _unprocessed_commands_exist_mutex;
     std::condition_variable* _wait_for_unprocessed_commands_to_exist;
-    RenderResourceHandle _free_handles[render_resource_handle::num];
-    uint32 num_free_handles;
+    // Current generation of each handle index, bumped when the handle is freed so that old copies of
+    // it go stale. Grows when no freed index is available.
+    Vector<uint16> _handle_generations;
+    Vector<uint32> _free_handle_indices;
+
+    // Destroyed during the current frame. Dispatched and freed by submit_command_lists, after the
+    // frame's recorded draws, which may still use them.
+    Vector<PendingResourceDestroy> _pending_destroys;
+
+    // The main thread waits on this when the command queue is full, the render thread signals it
+    // after consuming commands.
+    std::mutex _queue_space_mutex;
+    std::condition_variable _queue_space_available;
+    std::atomic<bool> _waiting_for_queue_space;
+
+    // How often and for how long, in microseconds, dispatching waited for the command queue.
+    uint64 num_queue_stalls;
+    uint64 queue_stall_time;
+
+    CommandList _command_lists[render_interface::max_command_list_threads];
+    std::atomic<uint32> _num_views; // Views handed out by next_view since the lists were last submitted.
+
+    // Frame tickets. The main thread hands out one per frame, the render thread completes them in
+    // order when the frame is presented.
+    uint32 frames_in_flight;
+    uint64 _submitted_frame;
+    std::atomic<uint64> _completed_frame;
+    std::mutex _frame_completed_mutex;
+    std::condition_variable _frame_completed;
+
+    RenderFence _last_fence;
+    std::atomic<uint64> _raised_fence;
+    std::atomic<uint32> _num_fence_waiters;
+    std::mutex _fence_mutex;
+    std::condition_variable _fence_raised;
 };
 
 namespace render_interface
 {
-    void init(RenderInterface* ri, ConcurrentRingBuffer* unprocessed_commands, bool* unprocessed_commands_exist,
+    void init(RenderInterface* ri, Allocator* allocator, ConcurrentRingBuffer* unprocessed_commands, bool* unprocessed_commands_exist,
               std::mutex* unprocessed_commands_exist_mutex, std::condition_variable* wait_for_unprocessed_commands_to_exist);
     RenderResourceHandle create_handle(RenderInterface* ri);
     void free_handle(RenderInterface* ri, RenderResourceHandle handle);
     void create_texture(RenderInterface* ri, Texture* texture);
     void create_render_world(RenderInterface* ri, World* world);
-    RendererCommand create_command(RendererCommand::Type type);
-    void dispatch(RenderInterface* ri, RendererCommand* command, void* dynamic_data, uint32 dynamic_data_size);
-    void dispatch(RenderInterface* ri, RendererCommand* command);
+
+    // The resources are destroyed and the handles freed once the frame is submitted, so that draws
+    // recorded earlier in the frame can still use them. Until then the handles aren't handed out again.
+    // world is the world sprite renderers are removed from, NotInitialized for other types.
+    void destroy_resources(RenderInterface* ri, RenderResourceData::Type type, RenderResourceHandle world, const RenderResourceHandle* handles, uint32 num);
+    void destroy_resource(RenderInterface* ri, RenderResourceData::Type type, RenderResourceHandle handle);
+
+    // Destroys the world's sprites and then the world itself on the render side.
+    void destroy_render_world(RenderInterface* ri, World* world);
+
+    // Reserves a command packet in the queue, to be filled in through renderer_command::data and
+    // renderer_command::dynamic_data. Nothing else may be dispatched until end_command is called.
+    RendererCommand* begin_command(RenderInterface* ri, RendererCommand::Type type, uint32 data_size, uint32 dynamic_data_size);
+    void end_command(RenderInterface* ri, RendererCommand* command);
+    void dispatch(RenderInterface* ri, RendererCommand::Type type, const void* data, uint32 data_size, const void* dynamic_data, uint32 dynamic_data_size);
+    void dispatch(RenderInterface* ri, RendererCommand::Type type, const void* data, uint32 data_size);
+
+    // Like begin_command, with the resource data already filled in.
+    RendererCommand* begin_create_resource(RenderInterface* ri, const RenderResourceData* resource, uint32 dynamic_data_size);
+    RendererCommand* begin_update_resource(RenderInterface* ri, const RenderResourceData* resource, uint32 dynamic_data_size);
     void create_resource(RenderInterface* ri, RenderResourceData* resource, void* dynamic_data, uint32 dynamic_data_size);
     void update_resource(RenderInterface* ri, RenderResourceData* resource, void* dynamic_data, uint32 dynamic_data_size);
     void create_resource(RenderInterface* ri, RenderResourceData* resource);
     void update_resource(RenderInterface* ri, RenderResourceData* resource);
-    RenderFence* create_fence(RenderInterface* ri);
-    void wait_for_fence(RenderFence* fence);
+    RenderFence create_fence(RenderInterface* ri);
+    bool fence_reached(const RenderInterface* ri, RenderFence fence);
+
+    // Spins for a while, then blocks until the render thread has raised fence.
+    void wait_for_fence(RenderInterface* ri, RenderFence fence);
     void wait_until_idle(RenderInterface* ri);
+
+    // Called by the render thread when it reaches a fence command.
+    void raise_fence(RenderInterface* ri, RenderFence fence);
+
+    // Called by the render thread after consuming commands. Cheap if nothing is waiting for space.
+    void signal_queue_space(RenderInterface* ri);
+
+    // The calling thread's command list. Any thread may record into its own list, the lists are
+    // allocated from ri->allocator, which must be thread safe.
+    CommandList* thread_command_list(RenderInterface* ri);
+
+    // Sort key view of the next view drawn this frame, views are drawn and composited in the order
+    // they are handed out.
+    uint32 next_view(RenderInterface* ri);
+
+    // Merges all command lists into the queue in sort key order and resets them, then dispatches the
+    // resource destroys of the frame. Call from the dispatching thread once no other thread is recording. Commands dispatched directly, such as
+    // resource updates and SetUniformValue, reach the queue first, so the ones dispatched during a
+    // frame affect all of that frame's recorded draws, also those recorded before them.
+    void submit_command_lists(RenderInterface* ri);
+    void deinit(RenderInterface* ri);
+
+    // Between 1 and max_frames_in_flight. With 1 the main thread doesn't start a frame until the
+    // previous one is presented.
+    void set_frames_in_flight(RenderInterface* ri, uint32 frames_in_flight);
+
+    // Called by the main thread before starting a frame. Blocks while frames_in_flight frames are
+    // submitted but not presented.
+    void wait_for_frame_slot(RenderInterface* ri);
+
+    // Returns the ticket of the frame being submitted, to be passed to complete_frame by the render
+    // thread.
+    uint64 submit_frame(RenderInterface* ri);
+    void complete_frame(RenderInterface* ri, uint64 frame_ticket);
     void resize(RenderInterface* ri, const Vector2u* resolution);
 }
 
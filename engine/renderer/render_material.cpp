@@ -1,5 +1,6 @@
 #include "render_material.h"
 #include <base/memory.h>
+#include <cstring>
 
 
 namespace bowtie
@@ -14,11 +15,16 @@ void set_uniform_value(RenderMaterial* m, uint64 name, const void* value, uint32
     {
         auto uniform = m->uniforms + i;
 
-        if (uniform->name == name)
+        if (uniform->name != name)
+            continue;
+
+        if (memcmp(uniform->value, value, value_size) != 0)
         {
             render_uniform::set_value(uniform, value, value_size);
-            break;
+            m->uniform_buffer_dirty = m->uniform_buffer_dirty || uniform->buffer_offset != render_uniform::not_in_buffer;
         }
+
+        break;
     }
 }
 
@@ -27,10 +33,13 @@ void set_uniform_value(RenderMaterial* m, uint64 name, const void* value, uint32
 namespace render_material
 {
 
-void init(RenderMaterial* m, uint32 num_uniforms, RenderResourceHandle shader)
+void init(RenderMaterial* m, uint32 num_uniforms, RenderResourceHandle shader, uint32 uniform_buffer_size)
 {
     m->shader = shader;
     m->num_uniforms = num_uniforms;
+    m->uniform_buffer = RenderResource();
+    m->uniform_buffer_size = uniform_buffer_size;
+    m->uniform_buffer_dirty = uniform_buffer_size > 0;
 }
 
 void set_uniform_vector4_value(RenderMaterial* m, uint64 name, const Vector4* value)
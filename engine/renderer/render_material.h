@@ -1,4 +1,5 @@
 #pragma once
+#include "render_resource.h"
 #include "render_resource_handle.h"
 #include "render_uniform.h"
 
@@ -10,11 +11,17 @@ struct RenderMaterial
     RenderResourceHandle shader;
     uint32 num_uniforms;
     RenderUniform uniforms[16];
+
+    // Holds the values of the uniforms which have a buffer offset. Created by the concrete renderer when
+    // first drawn, uploaded again only after a value changed.
+    RenderResource uniform_buffer;
+    uint32 uniform_buffer_size;
+    bool uniform_buffer_dirty;
 };
 
 namespace render_material
 {
-    void init(RenderMaterial* material, uint32 num_uniforms, RenderResourceHandle shader);
+    void init(RenderMaterial* material, uint32 num_uniforms, RenderResourceHandle shader, uint32 uniform_buffer_size);
     void set_uniform_vector4_value(RenderMaterial* material, uint64 name, const Vector4* value);
     void set_uniform_uint32_value(RenderMaterial* material, uint64 name, uint32 value);
     void set_uniform_real32_value(RenderMaterial* material, uint64 name, real32 value);
@@ -11,6 +11,7 @@ enum class RenderResourceType
 struct RenderResource
 {
     RenderResourceType type;
+    uint32 generation; // Generation of the handle mapping to this resource, set by render_resource_table::set.
     union
     {
         void* object;
@@ -24,6 +25,7 @@ namespace render_resource
     {
         RenderResource rr;
         rr.type = RenderResourceType::Handle;
+        rr.generation = 0;
         rr.handle = h;
         return rr;
     }
@@ -32,6 +34,7 @@ namespace render_resource
     {
         RenderResource rr;
         rr.type = RenderResourceType::Object;
+        rr.generation = 0;
         rr.object = p;
         return rr;
     }
@@ -3,11 +3,32 @@
 namespace bowtie
 {
 
+// Index into the resource table in the low bits, generation of that index in the high bits. Index 0 is
+// never handed out, so a handle of 0 (NotInitialized) is never valid.
 typedef uint32 RenderResourceHandle;
 
 namespace render_resource_handle
 {
-    const uint32 num = 4000;
+    const uint32 index_bits = 20;
+    const uint32 index_mask = (1 << index_bits) - 1;
+    const uint32 max_handles = 1 << index_bits;
+    const uint32 generation_bits = 12;
+    const uint32 generation_mask = (1 << generation_bits) - 1;
+
+    inline uint32 index(RenderResourceHandle handle)
+    {
+        return handle & index_mask;
+    }
+
+    inline uint32 generation(RenderResourceHandle handle)
+    {
+        return (handle >> index_bits) & generation_mask;
+    }
+
+    inline RenderResourceHandle create(uint32 index, uint32 generation)
+    {
+        return (generation << index_bits) | index;
+    }
 }
 
-} // namespace bowtie
\ No newline at end of file
+} // namespace bowtie
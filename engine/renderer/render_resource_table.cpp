@@ -1,31 +1,71 @@
 #include "render_resource_table.h"
 #include "render_resource.h"
 #include "render_resource_handle.h"
+#include <base/memory.h>
 
 
 namespace bowtie
 {
 
+namespace internal
+{
+
+RenderResource* render_resource_table_entry(const RenderResourceTable* table, RenderResourceHandle handle)
+{
+    auto index = render_resource_handle::index(handle);
+    auto page = index >> render_resource_table::page_bits;
+    Assert(page < table->num_pages, "Handle is out of range");
+    return table->pages[page] + (index & render_resource_table::page_mask);
+}
+
+} // namespace internal
+
 namespace render_resource_table
 {
 
-void free(RenderResource* table, RenderResourceHandle handle)
+void init(RenderResourceTable* table, Allocator* allocator)
+{
+    table->allocator = allocator;
+    memset(table->pages, 0, sizeof(table->pages));
+    table->num_pages = 0;
+}
+
+void deinit(RenderResourceTable* table)
 {
-    Assert(handle < render_resource_handle::num, "Handle is out of range");
-    table[handle] = RenderResource();
+    for (uint32 i = 0; i < table->num_pages; ++i)
+        table->allocator->dealloc(table->pages[i]);
 }
 
-RenderResource lookup(const RenderResource* table, RenderResourceHandle handle)
+void free(RenderResourceTable* table, RenderResourceHandle handle)
 {
-    Assert(handle < render_resource_handle::num, "Handle is out of range");
-    auto resource = table[handle];
+    auto entry = internal::render_resource_table_entry(table, handle);
+    Assert(entry->generation == render_resource_handle::generation(handle), "Trying to free render resource using stale handle.");
+    *entry = RenderResource();
+}
+
+RenderResource lookup(const RenderResourceTable* table, RenderResourceHandle handle)
+{
+    auto resource = *internal::render_resource_table_entry(table, handle);
     Assert(resource.type != RenderResourceType::NotInitialized, "Trying to lookup unused render resource.");
+    Assert(resource.generation == render_resource_handle::generation(handle), "Trying to lookup render resource using stale handle.");
     return resource;
 }
 
-void set(RenderResource* table, RenderResourceHandle handle, const RenderResource* resource)
+void set(RenderResourceTable* table, RenderResourceHandle handle, const RenderResource* resource)
 {
-    table[handle] = *resource;
+    auto page = render_resource_handle::index(handle) >> page_bits;
+    Assert(page < max_pages, "Handle is out of range");
+
+    while (table->num_pages <= page)
+    {
+        auto new_page = (RenderResource*)table->allocator->alloc(sizeof(RenderResource) * page_size);
+        memset(new_page, 0, sizeof(RenderResource) * page_size);
+        table->pages[table->num_pages++] = new_page;
+    }
+
+    auto entry = internal::render_resource_table_entry(table, handle);
+    *entry = *resource;
+    entry->generation = render_resource_handle::generation(handle);
 }
 
 } // namespace render_resource_lookup_table
@@ -5,13 +5,34 @@
 namespace bowtie
 {
 
+struct Allocator;
 struct RenderResource;
 
 namespace render_resource_table
 {
-    void free(RenderResource* table, RenderResourceHandle handle);
-    RenderResource lookup(const RenderResource* table, RenderResourceHandle handle);
-    void set(RenderResource* table, RenderResourceHandle handle, const RenderResource* resource);
+    // The table grows one page at a time and pages never move, so lookups are a shift and a mask.
+    const uint32 page_bits = 12;
+    const uint32 page_size = 1 << page_bits;
+    const uint32 page_mask = page_size - 1;
+    const uint32 max_pages = render_resource_handle::max_handles / page_size;
 }
 
-} // namespace bowtie;
\ No newline at end of file
+struct RenderResourceTable
+{
+    Allocator* allocator;
+    RenderResource* pages[render_resource_table::max_pages];
+    uint32 num_pages;
+};
+
+namespace render_resource_table
+{
+    void init(RenderResourceTable* table, Allocator* allocator);
+    void deinit(RenderResourceTable* table);
+    void free(RenderResourceTable* table, RenderResourceHandle handle);
+    RenderResource lookup(const RenderResourceTable* table, RenderResourceHandle handle);
+
+    // Adds pages if handle is outside of the table.
+    void set(RenderResourceTable* table, RenderResourceHandle handle, const RenderResource* resource);
+}
+
+} // namespace bowtie;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <base/matrix4.h>
+#include <base/quad.h>
 
 #include "../image.h"
 #include "uniform.h"
@@ -57,9 +58,28 @@ struct CreateSpriteRendererData
     uint32 num;
 };
 
+namespace sprite_renderer_field
+{
+    // The sprite fields which a sprite renderer update carries.
+    enum Mask { Geometry = 0x1, Color = 0x2, Material = 0x4, Depth = 0x8, All = 0xf };
+}
+
 struct UpdateSpriteRendererData
 {
+    RenderResourceHandle world;
     uint32 num;
+    uint32 fields; // Union of the fields changed on any of the sprites, all sprites carry all of them.
+};
+
+// The dynamic data of a sprite renderer update, num handles and num of each field in the update's field
+// mask. Fields that aren't in the mask are null.
+struct SpriteRendererUpdateData
+{
+    RenderResourceHandle* render_handle;
+    Quad* geometry;
+    Color* color;
+    RenderResourceHandle* material;
+    int32* depth;
 };
 
 struct RenderWorldResourceData
@@ -67,6 +87,14 @@ struct RenderWorldResourceData
     RenderResourceHandle handle;
 };
 
+// Followed by num handles in the dynamic data.
+struct DestroyResourceData
+{
+    RenderResourceData::Type type;
+    RenderResourceHandle world; // The world sprite renderers are removed from.
+    uint32 num;
+};
+
 namespace render_resource_data
 {
 
@@ -78,4 +106,52 @@ inline RenderResourceData create(RenderResourceData::Type type)
 
 } // render_resource_data
 
+namespace sprite_renderer_update
+{
+
+inline uint32 size(uint32 num, uint32 fields)
+{
+    uint32 size = sizeof(RenderResourceHandle);
+    size += (fields & sprite_renderer_field::Geometry) ? sizeof(Quad) : 0;
+    size += (fields & sprite_renderer_field::Color) ? sizeof(Color) : 0;
+    size += (fields & sprite_renderer_field::Material) ? sizeof(RenderResourceHandle) : 0;
+    size += (fields & sprite_renderer_field::Depth) ? sizeof(int32) : 0;
+    return size * num;
+}
+
+inline SpriteRendererUpdateData from_buffer(void* buffer, uint32 num, uint32 fields)
+{
+    // Largest fields first, so that every array stays aligned.
+    SpriteRendererUpdateData data = {};
+    auto p = (uint8*)buffer;
+
+    if (fields & sprite_renderer_field::Geometry)
+    {
+        data.geometry = (Quad*)p;
+        p += sizeof(Quad) * num;
+    }
+
+    if (fields & sprite_renderer_field::Color)
+    {
+        data.color = (Color*)p;
+        p += sizeof(Color) * num;
+    }
+
+    data.render_handle = (RenderResourceHandle*)p;
+    p += sizeof(RenderResourceHandle) * num;
+
+    if (fields & sprite_renderer_field::Material)
+    {
+        data.material = (RenderResourceHandle*)p;
+        p += sizeof(RenderResourceHandle) * num;
+    }
+
+    if (fields & sprite_renderer_field::Depth)
+        data.depth = (int32*)p;
+
+    return data;
+}
+
+} // sprite_renderer_update
+
 } // namespace bowtie
@@ -12,6 +12,23 @@ namespace render_uniform
         memcpy(uniform->value, value, value_size);
     }
 
+    uint32 value_size(uniform::Type type)
+    {
+        switch (type)
+        {
+        case uniform::Float: return sizeof(real32);
+        case uniform::Vec2: return 2 * sizeof(real32);
+        case uniform::Vec3: return 3 * sizeof(real32);
+        case uniform::Vec4: return 4 * sizeof(real32);
+        case uniform::Mat3: return 9 * sizeof(real32);
+        case uniform::Mat4: return 16 * sizeof(real32);
+        case uniform::Texture1:
+        case uniform::Texture2:
+        case uniform::Texture3: return sizeof(uint32);
+        default: Error("Unknown uniform type"); return 0;
+        }
+    }
+
 } // namespace render_uniform
 
 }
\ No newline at end of file
@@ -11,13 +11,16 @@ struct RenderUniform
     uniform::AutomaticValue automatic_value;
     uint64 name;
     uint32 location;
+    uint32 buffer_offset; // Offset in the material's uniform buffer, render_uniform::not_in_buffer if it isn't there.
     uniform::Type type;
-    uint8 value[4];
+    uint8 value[16];
 };
 
 namespace render_uniform
 {
+    const uint32 not_in_buffer = (uint32)-1;
     void set_value(RenderUniform* uniform, const void* value, uint32 value_size);
+    uint32 value_size(uniform::Type type);
 }
 
 }
\ No newline at end of file
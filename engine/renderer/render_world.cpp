@@ -1,37 +1,314 @@
 #include "render_world.h"
 #include <base/vector.h>
+#include <base/vector4.h>
+#include <base/quad.h>
+#include <base/radix_sort.h>
 #include "../rect.h"
+#include "render_material.h"
+#include "render_resource_table.h"
 #include "render_target.h"
-#include "render_component.h"
-#include <algorithm>
 
 namespace bowtie
 {
 
+namespace internal
+{
+
+const uint32 render_world_sprite_size = sizeof(uint32) + sizeof(Quad) + sizeof(Color) + sizeof(RenderResourceHandle) + sizeof(int32);
+
+RenderWorldSpriteData render_world_sprite_data(void* buffer, uint32 capacity)
+{
+    RenderWorldSpriteData data;
+    data.geometry = (Quad*)buffer;
+    data.color = (Color*)(data.geometry + capacity);
+    data.material = (RenderResourceHandle*)(data.color + capacity);
+    data.depth = (int32*)(data.material + capacity);
+    data.id = (uint32*)(data.depth + capacity);
+    return data;
+}
+
+void copy_sprites(const RenderWorldSpriteData* from, RenderWorldSpriteData* to, uint32 from_slot, uint32 to_slot, uint32 num)
+{
+    memcpy(to->id + to_slot, from->id + from_slot, num * sizeof(uint32));
+    memcpy(to->geometry + to_slot, from->geometry + from_slot, num * sizeof(Quad));
+    memcpy(to->color + to_slot, from->color + from_slot, num * sizeof(Color));
+    memcpy(to->material + to_slot, from->material + from_slot, num * sizeof(RenderResourceHandle));
+    memcpy(to->depth + to_slot, from->depth + from_slot, num * sizeof(int32));
+}
+
+// From the most significant bits: 16 bits of depth, then the low 12 bits of the shader's handle index and
+// the low 16 bits of the texture's, which only group sprites, and the 20 bit material handle index.
+uint64 render_world_sort_key(const RenderResourceTable* resource_table, RenderResourceHandle material_handle, int32 depth)
+{
+    auto material = (RenderMaterial*)render_resource_table::lookup(resource_table, material_handle).object;
+    RenderResourceHandle texture = NotInitialized;
+
+    for (uint32 i = 0; i < material->num_uniforms; ++i)
+    {
+        if (material->uniforms[i].type != uniform::Texture1)
+            continue;
+
+        texture = *(RenderResourceHandle*)material->uniforms[i].value;
+        break;
+    }
+
+    Assert(depth >= -32768 && depth <= 32767, "Sprite depth must fit in 16 bits.");
+    auto shader_index = render_resource_handle::index(material->shader) & 0xfff;
+    auto texture_index = render_resource_handle::index(texture) & 0xffff;
+    auto material_index = render_resource_handle::index(material_handle);
+    return (uint64(depth + 32768) << 48) | (uint64(shader_index) << 36) | (uint64(texture_index) << 20) | material_index;
+}
+
+void mark_sprites_dirty(RenderWorld* rw, uint32 first_slot, uint32 end_slot)
+{
+    if (first_slot >= end_slot)
+        return;
+
+    auto last_block = (end_slot - 1) / render_world::sprite_block_size;
+
+    for (uint32 block = first_slot / render_world::sprite_block_size; block <= last_block; ++block)
+        rw->dirty_sprite_blocks[block] = 1;
+
+    rw->has_dirty_sprite_blocks = true;
+}
+
+void set_sprites_capacity(RenderWorld* rw, uint32 capacity)
+{
+    auto buffer = rw->allocator->alloc(render_world_sprite_size * capacity);
+    auto sprites = render_world_sprite_data(buffer, capacity);
+    copy_sprites(&rw->sprites, &sprites, 0, 0, rw->num_sprites);
+
+    auto old_num_blocks = render_world::num_sprite_blocks(rw);
+    rw->sprites_capacity = capacity;
+    auto num_blocks = render_world::num_sprite_blocks(rw);
+    auto dirty_blocks = (uint8*)rw->allocator->alloc(num_blocks);
+    memset(dirty_blocks, 0, num_blocks);
+
+    if (rw->sprite_buffer != nullptr)
+    {
+        memcpy(dirty_blocks, rw->dirty_sprite_blocks, old_num_blocks);
+        rw->allocator->dealloc(rw->sprite_buffer);
+        rw->allocator->dealloc(rw->dirty_sprite_blocks);
+        rw->allocator->dealloc(rw->sorted_sprite_buffer);
+        rw->allocator->dealloc(rw->sort_keys);
+    }
+
+    rw->sprite_buffer = buffer;
+    rw->sprites = sprites;
+    rw->dirty_sprite_blocks = dirty_blocks;
+    rw->sorted_sprite_buffer = rw->allocator->alloc_raw(render_world_sprite_size * capacity);
+    rw->sort_keys = (uint64*)rw->allocator->alloc_raw((sizeof(uint64) + sizeof(uint32)) * capacity * 2);
+    rw->sort_order = (uint32*)(rw->sort_keys + capacity * 2);
+}
+
+} // namespace internal
+
 namespace render_world
 {
 
-void init(RenderWorld* rw, const RenderTarget* render_target, Allocator* allocator)
+void init(RenderWorld* rw, RenderTarget* render_target, Allocator* allocator)
 {
-    vector::init(&rw->components, allocator);
-    rw->render_target = *render_target;
+    rw->allocator = allocator;
+    rw->sprite_buffer = nullptr;
+    memset(&rw->sprites, 0, sizeof(RenderWorldSpriteData));
+    rw->num_sprites = 0;
+    rw->sprites_capacity = 0;
+    rw->sprites_unsorted = false;
+    rw->dirty_sprite_blocks = nullptr;
+    rw->has_dirty_sprite_blocks = false;
+    rw->sorted_sprite_buffer = nullptr;
+    rw->sort_keys = nullptr;
+    rw->sort_order = nullptr;
+    rw->gpu_sprites = RenderResource();
+    rw->gpu_sprites_capacity = 0;
+    vector::init(&rw->sprite_slot_by_id, allocator);
+    vector::init(&rw->free_sprite_ids, allocator);
+    rw->render_target = render_target;
 }
 
 void deinit(RenderWorld* rw)
 {
-    vector::deinit(&rw->components);
+    if (rw->sprite_buffer != nullptr)
+    {
+        rw->allocator->dealloc(rw->sprite_buffer);
+        rw->allocator->dealloc(rw->dirty_sprite_blocks);
+        rw->allocator->dealloc(rw->sorted_sprite_buffer);
+        rw->allocator->dealloc(rw->sort_keys);
+    }
+
+    vector::deinit(&rw->sprite_slot_by_id);
+    vector::deinit(&rw->free_sprite_ids);
 }
 
-void add_component(RenderWorld* rw, RenderComponent* component)
+uint32 create_sprite(RenderWorld* rw)
 {
-    vector::push(&rw->components, component);
+    if (rw->num_sprites == rw->sprites_capacity)
+        internal::set_sprites_capacity(rw, rw->sprites_capacity * 2 + 64);
+
+    uint32 id;
+
+    if (rw->free_sprite_ids.size > 0)
+    {
+        id = *vector::last(&rw->free_sprite_ids);
+        vector::pop(&rw->free_sprite_ids);
+    }
+    else
+    {
+        id = rw->sprite_slot_by_id.size;
+        vector::push(&rw->sprite_slot_by_id, (uint32)0);
+    }
+
+    auto slot = rw->num_sprites++;
+    rw->sprite_slot_by_id[id] = slot;
+    rw->sprites.id[slot] = id;
+    rw->sprites_unsorted = true;
+    internal::mark_sprites_dirty(rw, slot, slot + 1);
+    return id;
 }
 
-void sort(RenderWorld* rw)
+void destroy_sprite(RenderWorld* rw, uint32 id)
 {
-    std::sort(&rw->components[0], &rw->components[rw->components.size], [](RenderComponent* x, RenderComponent* y){ return (x->depth == y->depth && x->material < y->material) || x->depth < y->depth; });
+    auto slot = sprite_slot(rw, id);
+    auto last = --rw->num_sprites;
+
+    if (slot != last)
+    {
+        internal::copy_sprites(&rw->sprites, &rw->sprites, last, slot, 1);
+        rw->sprite_slot_by_id[rw->sprites.id[slot]] = slot;
+        rw->sprites_unsorted = true;
+        internal::mark_sprites_dirty(rw, slot, slot + 1);
+    }
+
+    vector::push(&rw->free_sprite_ids, id);
+}
+
+uint32 sprite_slot(const RenderWorld* rw, uint32 id)
+{
+    Assert(id < rw->sprite_slot_by_id.size, "Sprite id is out of range.");
+    auto slot = rw->sprite_slot_by_id[id];
+    Assert(slot < rw->num_sprites && rw->sprites.id[slot] == id, "Trying to use destroyed sprite.");
+    return slot;
+}
+
+uint32 num_sprite_blocks(const RenderWorld* rw)
+{
+    return (rw->sprites_capacity + sprite_block_size - 1) / sprite_block_size;
+}
+
+void clear_dirty_sprites(RenderWorld* rw)
+{
+    if (!rw->has_dirty_sprite_blocks)
+        return;
+
+    memset(rw->dirty_sprite_blocks, 0, num_sprite_blocks(rw));
+    rw->has_dirty_sprite_blocks = false;
+}
+
+void update_sprites(RenderWorld* rw, const uint32* slots, uint32 num, const Quad* geometry, const Color* color, const RenderResourceHandle* material, const int32* depth)
+{
+    if ((geometry != nullptr || color != nullptr) && num > 0)
+    {
+        for (uint32 i = 0; i < num; ++i)
+            rw->dirty_sprite_blocks[slots[i] / sprite_block_size] = 1;
+
+        rw->has_dirty_sprite_blocks = true;
+    }
+
+    // One pass per field, so that each loop only touches the arrays it writes.
+    if (geometry != nullptr)
+    {
+        auto dest = rw->sprites.geometry;
+
+        for (uint32 i = 0; i < num; ++i)
+            dest[slots[i]] = geometry[i];
+    }
+
+    if (color != nullptr)
+    {
+        auto dest = rw->sprites.color;
+
+        for (uint32 i = 0; i < num; ++i)
+            dest[slots[i]] = color[i];
+    }
+
+    if (material != nullptr || depth != nullptr)
+        rw->sprites_unsorted = true;
+
+    if (material != nullptr)
+    {
+        auto dest = rw->sprites.material;
+
+        for (uint32 i = 0; i < num; ++i)
+            dest[slots[i]] = material[i];
+    }
+
+    if (depth != nullptr)
+    {
+        auto dest = rw->sprites.depth;
+
+        for (uint32 i = 0; i < num; ++i)
+            dest[slots[i]] = depth[i];
+    }
+}
+
+void sort(RenderWorld* rw, const RenderResourceTable* resource_table)
+{
+    auto num = rw->num_sprites;
+
+    if (!rw->sprites_unsorted || num < 2)
+    {
+        rw->sprites_unsorted = false;
+        return;
+    }
+
+    auto sprites = &rw->sprites;
+    auto keys = rw->sort_keys;
+    auto order = rw->sort_order;
+
+    // Sprites mostly share materials, so only look up the material when it changes.
+    RenderResourceHandle last_material = NotInitialized;
+    int32 last_depth = 0;
+    uint64 last_key = 0;
+
+    for (uint32 i = 0; i < num; ++i)
+    {
+        if (i == 0 || sprites->material[i] != last_material || sprites->depth[i] != last_depth)
+        {
+            last_material = sprites->material[i];
+            last_depth = sprites->depth[i];
+            last_key = internal::render_world_sort_key(resource_table, last_material, last_depth);
+        }
+
+        keys[i] = last_key;
+        order[i] = i;
+    }
+
+    radix_sort::sort(keys, order, keys + num, order + num, num);
+    rw->sprites_unsorted = false;
+    uint32 first_moved = 0;
+
+    while (first_moved < num && order[first_moved] == first_moved)
+        ++first_moved;
+
+    if (first_moved == num)
+        return;
+
+    // Gather into the other buffer so that drawing walks the arrays in order.
+    auto sorted = internal::render_world_sprite_data(rw->sorted_sprite_buffer, rw->sprites_capacity);
+
+    for (uint32 i = 0; i < num; ++i)
+    {
+        internal::copy_sprites(sprites, &sorted, order[i], i, 1);
+        rw->sprite_slot_by_id[sorted.id[i]] = i;
+    }
+
+    auto sorted_buffer = rw->sorted_sprite_buffer;
+    rw->sorted_sprite_buffer = rw->sprite_buffer;
+    rw->sprite_buffer = sorted_buffer;
+    rw->sprites = sorted;
+    internal::mark_sprites_dirty(rw, first_moved, num);
 }
 
 } // namespace render_world
 
-} // namespace bowtie
\ No newline at end of file
+} // namespace bowtie
@@ -2,27 +2,84 @@
 
 #include <base/collection_types.h>
 #include "render_resource.h"
+#include "render_resource_handle.h"
 #include "render_target.h"
 
 namespace bowtie
 {
 
 struct Allocator;
+struct Quad;
 struct Rect;
-struct RenderComponent;
+struct RenderResourceTable;
+struct Vector4;
+typedef Vector4 Color;
+
+// One array per field, indexed by slot. Slots are dense, a sprite's slot changes when another sprite is
+// removed or the world is sorted.
+struct RenderWorldSpriteData
+{
+    uint32* id;
+    Quad* geometry;
+    Color* color;
+    RenderResourceHandle* material;
+    int32* depth;
+};
 
 struct RenderWorld
 {
-    Vector<RenderComponent*> components;
-    RenderTarget render_target;
+    Allocator* allocator;
+    void* sprite_buffer;
+    RenderWorldSpriteData sprites;
+    uint32 num_sprites;
+    uint32 sprites_capacity;
+    bool sprites_unsorted; // Set when sprites are added or removed, or their depth, material or material texture changes.
+
+    // Sort scratch, sized with sprites_capacity. Sorting gathers into sorted_sprite_buffer, which is then
+    // swapped with sprite_buffer. Keys and order are double sized, the radix sort ping-pongs between halves.
+    void* sorted_sprite_buffer;
+    uint64* sort_keys;
+    uint32* sort_order;
+
+    // Per sprite block, set when geometry or color of a slot in it changed.
+    uint8* dirty_sprite_blocks;
+    bool has_dirty_sprite_blocks;
+
+    // Copy of the sprites on the GPU, owned by the concrete renderer. Has room for gpu_sprites_capacity
+    // sprites, when that's less than sprites_capacity the concrete renderer recreates it.
+    RenderResource gpu_sprites;
+    uint32 gpu_sprites_capacity;
+
+    // Sprite ids stay the same for the lifetime of the sprite, they're what the resource table maps
+    // sprite handles to.
+    Vector<uint32> sprite_slot_by_id;
+    Vector<uint32> free_sprite_ids;
+    RenderTarget* render_target; // Points into the renderer's render targets, which are recreated on resize.
 };
 
 namespace render_world
 {
-    void init(RenderWorld* rw, const RenderTarget* render_target, Allocator* allocator);
+    void init(RenderWorld* rw, RenderTarget* render_target, Allocator* allocator);
     void deinit(RenderWorld* rw);
-    void add_component(RenderWorld* rw, RenderComponent* component);
-    void sort(RenderWorld* rw);
+
+    // Returns the id of the new sprite, its fields are set through the slot.
+    uint32 create_sprite(RenderWorld* rw);
+
+    // Moves the last sprite into the removed sprite's slot.
+    void destroy_sprite(RenderWorld* rw, uint32 id);
+    uint32 sprite_slot(const RenderWorld* rw, uint32 id);
+
+    // Changed sprites are tracked per block of slots, the concrete renderer uploads dirty blocks.
+    const uint32 sprite_block_size = 256;
+    uint32 num_sprite_blocks(const RenderWorld* rw);
+    void clear_dirty_sprites(RenderWorld* rw);
+
+    // Scatters num values of each non-null field into the given slots.
+    void update_sprites(RenderWorld* rw, const uint32* slots, uint32 num, const Quad* geometry, const Color* color, const RenderResourceHandle* material, const int32* depth);
+
+    // Orders the sprite arrays by depth, shader, texture and material. Does nothing if no sprite was added,
+    // removed or had its depth or material changed since the last sort.
+    void sort(RenderWorld* rw, const RenderResourceTable* resource_table);
 }
 
-};
\ No newline at end of file
+};
@@ -1,6 +1,5 @@
 #include "renderer.h"
 #include <cstdlib>
-#include "render_fence.h"
 #include "../shader_utils.h"
 #include "../entity/components/sprite_renderer_component.h"
 #include "../material.h"
@@ -12,7 +11,7 @@
 #include "render_world.h"
 #include "render_target.h"
 #include "render_texture.h"
-#include "render_component.h"
+#include <base/quad.h>
 
 namespace bowtie
 {
@@ -70,6 +69,7 @@ RenderUniform create_uniform(ConcreteRenderer* concrete_renderer, RenderResource
     ru.type = uniform_data->type;
     ru.name = name_hash;
     ru.location = location;
+    ru.buffer_offset = concrete_renderer->get_material_uniform_buffer_offset(shader, name);
 
     if (uniform_data->automatic_value != uniform::None)
         ru.automatic_value = uniform_data->automatic_value;
@@ -77,11 +77,11 @@ RenderUniform create_uniform(ConcreteRenderer* concrete_renderer, RenderResource
     return ru;
 }
 
-SingleCreatedResource create_material(Allocator* allocator, ConcreteRenderer* concrete_renderer, void* dynamic_data, const RenderResource* resource_table, const MaterialResourceData* data)
+SingleCreatedResource create_material(Allocator* allocator, ConcreteRenderer* concrete_renderer, void* dynamic_data, const RenderResourceTable* resource_table, const MaterialResourceData* data)
 {
     auto material = (RenderMaterial*)allocator->alloc(sizeof(RenderMaterial));
-    render_material::init(material, data->num_uniforms, data->shader);
     auto shader = render_resource_table::lookup(resource_table, data->shader);
+    render_material::init(material, data->num_uniforms, data->shader, concrete_renderer->get_material_uniform_buffer_size(shader));
     auto uniforms_data = (UniformResourceData*)dynamic_data;
     
     for (uint32 i = 0; i < data->num_uniforms; ++i)
@@ -130,19 +130,19 @@ RenderTarget* find_free_render_target_slot(RenderTarget* render_targets)
     return nullptr;
 }
 
-RenderTarget create_render_target(ConcreteRenderer* concrete_renderer, const RenderTexture* texture, RenderTarget* render_targets)
+RenderTarget* create_render_target(ConcreteRenderer* concrete_renderer, const RenderTexture* texture, RenderTarget* render_targets)
 {
     auto render_target_resource = concrete_renderer->create_render_target(texture);
     auto rt = find_free_render_target_slot(render_targets);
     rt->handle = render_target_resource;
     rt->texture = *texture;
-    return *rt;
+    return rt;
 }
 
 RenderResource create_render_target_resource(ConcreteRenderer* concrete_renderer, Allocator* allocator, const RenderTexture* texture, RenderTarget* render_targets)
 {
     auto render_target = (RenderTarget*)allocator->alloc(sizeof(RenderTarget));
-    *render_target = create_render_target(concrete_renderer, texture, render_targets);
+    *render_target = *create_render_target(concrete_renderer, texture, render_targets);
     return render_resource::create_object(render_target);
 }
 
@@ -170,7 +170,7 @@ RenderResource create_texture_resource(ConcreteRenderer* concrete_renderer, Allo
     return render_resource::create_object(render_texture);
 }
 
-SingleCreatedResource create_world(Allocator* allocator, const RenderWorldResourceData* data, const RenderTarget* render_target)
+SingleCreatedResource create_world(Allocator* allocator, const RenderWorldResourceData* data, RenderTarget* render_target)
 {
     auto rw = (RenderWorld*)allocator->alloc(sizeof(RenderWorld));
     render_world::init(rw, render_target, allocator);
@@ -182,17 +182,10 @@ void flip(RendererContext* context, PlatformRendererContextData* platform_data)
     context->flip(platform_data);
 }
 
-void raise_fence(RenderFence* fence)
+void draw(ConcreteRenderer* concrete_renderer, const Vector2u* resolution, const RenderResourceTable* resource_table, RenderWorld** rendered_worlds, uint32* num_rendered_worlds, RenderWorld* render_world, const Rect* view, real32 time)
 {
-    std::lock_guard<std::mutex> fence_lock(fence->mutex);
-    fence->processed = true;
-    fence->fence_processed.notify_all();
-}
-
-void draw(ConcreteRenderer* concrete_renderer, const Vector2u* resolution, RenderResource* resource_table, RenderWorld** rendered_worlds, uint32* num_rendered_worlds, RenderWorld* render_world, const Rect* view, real32 time)
-{
-    render_world::sort(render_world);
-    concrete_renderer->set_render_target(resolution, render_world->render_target.handle);
+    render_world::sort(render_world, resource_table);
+    concrete_renderer->set_render_target(resolution, render_world->render_target->handle);
     concrete_renderer->clear();
     concrete_renderer->draw(view, render_world, resolution, time, resource_table);
     Assert(*num_rendered_worlds < renderer::max_rendered_worlds, "Rendererd too many worlds");
@@ -200,7 +193,7 @@ void draw(ConcreteRenderer* concrete_renderer, const Vector2u* resolution, Rende
     ++(*num_rendered_worlds);
 }
 
-SingleUpdatedResource update_shader(ConcreteRenderer* concrete_renderer, const RenderResource* resource_table, void* dynamic_data, const ShaderResourceData* data)
+SingleUpdatedResource update_shader(ConcreteRenderer* concrete_renderer, const RenderResourceTable* resource_table, void* dynamic_data, const ShaderResourceData* data)
 {
     RenderResource old_resource = render_resource_table::lookup(resource_table, data->handle);
     const char* vertex_source = (const char*)memory::pointer_add(dynamic_data, data->vertex_shader_source_offset);
@@ -217,7 +210,7 @@ CreatedResources create_resources(Renderer* r, RenderResourceData::Type type, vo
 {
     switch (type)
     {
-    case RenderResourceData::RenderMaterial: return copy_single_resource(create_material(r->allocator, &r->_concrete_renderer, dynamic_data, r->resource_table, (MaterialResourceData*)data), r->allocator);
+    case RenderResourceData::RenderMaterial: return copy_single_resource(create_material(r->allocator, &r->_concrete_renderer, dynamic_data, &r->resource_table, (MaterialResourceData*)data), r->allocator);
     case RenderResourceData::Shader: return copy_single_resource(create_shader(&r->_concrete_renderer, dynamic_data, (ShaderResourceData*)data), r->allocator);
     case RenderResourceData::Texture: {
         auto texture_resource_data = (TextureResourceData*)data;
@@ -227,25 +220,25 @@ CreatedResources create_resources(Renderer* r, RenderResourceData::Type type, vo
     case RenderResourceData::World: {
         auto texture = create_texture(&r->_concrete_renderer, PixelFormat::RGBA, &r->resolution, 0);
         auto render_target = create_render_target(&r->_concrete_renderer, &texture, r->_render_targets);
-        return copy_single_resource(create_world(r->allocator, (RenderWorldResourceData*)data, &render_target), r->allocator);
+        return copy_single_resource(create_world(r->allocator, (RenderWorldResourceData*)data, render_target), r->allocator);
     }
     case RenderResourceData::SpriteRenderer: {
         auto sprite_data = (CreateSpriteRendererData*)data;
-        auto rw = (RenderWorld*)render_resource_table::lookup(r->resource_table, sprite_data->world).object;
+        auto rw = (RenderWorld*)render_resource_table::lookup(&r->resource_table, sprite_data->world).object;
         CreatedResources cr = create_created_resources(sprite_data->num, r->allocator);
         auto sprite = sprite_renderer_component::create_data_from_buffer(dynamic_data, sprite_data->num);
 
         for (uint32 i = 0; i < sprite_data->num; ++i)
         {
-            auto component = (RenderComponent*)r->allocator->alloc(sizeof(RenderComponent));
-            component->color = sprite.color[i];
-            component->material = sprite.material[i].render_handle;
-            component->geometry = sprite.geometry[i];
-            component->depth = sprite.depth[i];
-            render_world::add_component(rw, component);
+            auto id = render_world::create_sprite(rw);
+            auto slot = render_world::sprite_slot(rw, id);
+            rw->sprites.color[slot] = sprite.color[i];
+            rw->sprites.material[slot] = sprite.material[i].render_handle;
+            rw->sprites.geometry[slot] = sprite.geometry[i];
+            rw->sprites.depth[slot] = sprite.depth[i];
 
             cr.handles[i] = sprite.render_handle[i];
-            cr.resources[i] = render_resource::create_object(component);
+            cr.resources[i] = render_resource::create_handle(id);
         }
 
         return cr;
@@ -277,50 +270,126 @@ UpdatedResources update_resources(Renderer* r, RenderResourceData::Type type, vo
 {
     switch (type)
     {
-        case RenderResourceData::Shader: return single_update(update_shader(&r->_concrete_renderer, r->resource_table, dynamic_data, (ShaderResourceData*)data), r->allocator);
-        case RenderResourceData::SpriteRenderer: {
-            auto sprite_data = (UpdateSpriteRendererData*)data;
-            UpdatedResources ur = create_updated_resources(sprite_data->num, r->allocator);
+        case RenderResourceData::Shader: return single_update(update_shader(&r->_concrete_renderer, &r->resource_table, dynamic_data, (ShaderResourceData*)data), r->allocator);
+        default: Error("Unknown render resource type"); return UpdatedResources();
+    }
+}
 
-            for (uint32 i = 0; i < sprite_data->num; ++i)
-            {
-                auto sprite = sprite_renderer_component::create_data_from_buffer(dynamic_data, sprite_data->num);
-                auto component = (RenderComponent*)render_resource_table::lookup(r->resource_table, sprite.render_handle[i]).object;
-                component->color = sprite.color[i];
-                component->material = sprite.material[i].render_handle;
-                component->geometry = sprite.geometry[i];
-                component->depth = sprite.depth[i];
-
-                ur.handles[i] = sprite.render_handle[i];
-                ur.new_resources[i] = render_resource::create_object(component);
-                ur.old_resources[i] = render_resource::create_object(component);
-            }
+// Sprite updates don't change what the handles map to, so they skip the generic resource update.
+void update_sprites(Renderer* r, const UpdateSpriteRendererData* data, void* dynamic_data)
+{
+    auto rw = (RenderWorld*)render_resource_table::lookup(&r->resource_table, data->world).object;
+    auto update = sprite_renderer_update::from_buffer(dynamic_data, data->num, data->fields);
+    auto slots = (uint32*)r->allocator->alloc(sizeof(uint32) * data->num);
 
-            return ur;
-        }
-        default: Error("Unknown render resource type"); return UpdatedResources();
+    for (uint32 i = 0; i < data->num; ++i)
+        slots[i] = render_world::sprite_slot(rw, render_resource_table::lookup(&r->resource_table, update.render_handle[i]).handle);
+
+    render_world::update_sprites(rw, slots, data->num, update.geometry, update.color, update.material, update.depth);
+    r->allocator->dealloc(slots);
+}
+
+void set_resource_object(Renderer* r, RenderResourceHandle handle, RenderResourceData::Type type)
+{
+    auto index = render_resource_handle::index(handle);
+    auto objects = &r->_resource_objects;
+
+    if (index >= objects->size)
+    {
+        auto old_size = objects->size;
+        vector::resize(objects, index + 1);
+        memset(objects->data + old_size, 0, sizeof(RendererResourceObject) * (objects->size - old_size));
+    }
+
+    (*objects)[index] = RendererResourceObject(type, handle);
+}
+
+void clear_resource_object(Renderer* r, RenderResourceHandle handle)
+{
+    memset(&r->_resource_objects[render_resource_handle::index(handle)], 0, sizeof(RendererResourceObject));
+}
+
+// Sprite sort keys read the texture of the sprite's material.
+void mark_render_worlds_unsorted(Renderer* r)
+{
+    for (uint32 i = 0; i < r->_resource_objects.size; ++i)
+    {
+        auto resource_object = &r->_resource_objects[i];
+
+        if (resource_object->handle == NotInitialized || resource_object->type != RenderResourceData::World)
+            continue;
+
+        auto rw = (RenderWorld*)render_resource_table::lookup(&r->resource_table, resource_object->handle).object;
+        rw->sprites_unsorted = true;
     }
 }
 
-void execute_command(Renderer* r, const RendererCommand* command)
+void destroy_render_resource(Renderer* r, RenderResourceData::Type type, RenderResourceHandle handle, RenderResourceHandle world)
+{
+    auto resource = render_resource_table::lookup(&r->resource_table, handle);
+
+    switch (type)
+    {
+    case RenderResourceData::Shader:
+        r->_concrete_renderer.destroy_shader(resource);
+        break;
+    case RenderResourceData::Texture:
+        r->_concrete_renderer.destroy_texture(resource);
+        break;
+    case RenderResourceData::RenderMaterial: {
+        auto material = (RenderMaterial*)resource.object;
+
+        if (material->uniform_buffer.type != RenderResourceType::NotInitialized)
+            r->_concrete_renderer.destroy_uniform_buffer(material->uniform_buffer);
+    } break;
+    case RenderResourceData::World: {
+        auto rw = (RenderWorld*)resource.object;
+        r->_concrete_renderer.destroy_render_target(render_resource::create_object(rw->render_target));
+        memset(rw->render_target, 0, sizeof(RenderTarget));
+
+        if (rw->gpu_sprites.type != RenderResourceType::NotInitialized)
+            r->_concrete_renderer.destroy_gpu_sprites(rw->gpu_sprites);
+
+        render_world::deinit(rw);
+    } break;
+    case RenderResourceData::SpriteRenderer: {
+        auto rw = (RenderWorld*)render_resource_table::lookup(&r->resource_table, world).object;
+        render_world::destroy_sprite(rw, resource.handle);
+    } break;
+    default: Error("Unknown render resource type"); break;
+    }
+
+    if (resource.type == RenderResourceType::Object)
+    {
+        r->allocator->dealloc(resource.object);
+        clear_resource_object(r, handle);
+    }
+
+    render_resource_table::free(&r->resource_table, handle);
+}
+
+void execute_command(Renderer* r, RendererCommand* command)
 {
     switch (command->type)
     {
+        case RendererCommand::Padding:
+            break;
+
         case RendererCommand::Fence:
-            raise_fence((RenderFence*)command->data);
+            render_interface::raise_fence(&r->render_interface, *(RenderFence*)renderer_command::data(command));
             break;
 
         case RendererCommand::RenderWorld:
         {
-            auto rwd = (RenderWorldData*)command->data;
-            draw(&r->_concrete_renderer, &r->resolution, r->resource_table, r->_rendered_worlds, &r->num_rendered_worlds, (RenderWorld*)render_resource_table::lookup(r->resource_table, rwd->render_world).object, &rwd->view, rwd->time);
+            auto rwd = (RenderWorldData*)renderer_command::data(command);
+            draw(&r->_concrete_renderer, &r->resolution, &r->resource_table, r->_rendered_worlds, &r->num_rendered_worlds, (RenderWorld*)render_resource_table::lookup(&r->resource_table, rwd->render_world).object, &rwd->view, rwd->time);
         } break;
 
         // Rename to CreateResource
         case RendererCommand::LoadResource:
         {
-            auto data = (RenderResourceData*)command->data;
-            void* dynamic_data = command->dynamic_data;
+            auto data = (RenderResourceData*)renderer_command::data(command);
+            void* dynamic_data = renderer_command::dynamic_data(command);
 
             auto created_resources = create_resources(r, data->type, data->data, dynamic_data);
 
@@ -332,11 +401,11 @@ void execute_command(Renderer* r, const RendererCommand* command)
                 Assert(resource.type != RenderResourceType::NotInitialized, "Failed to load resource!");
 
                 // Map handle from outside of renderer (RenderResourceHandle) to internal handle (RenderResource).
-                render_resource_table::set(r->resource_table, handle, &resource);
+                render_resource_table::set(&r->resource_table, handle, &resource);
 
                 // Save dynamically allocated render resources in _resource_objects for deallocation on shutdown.
                 if (resource.type == RenderResourceType::Object)
-                    r->_resource_objects[handle] = RendererResourceObject(data->type, handle);
+                    set_resource_object(r, handle, data->type);
             }
 
             r->allocator->dealloc(created_resources.handles);
@@ -345,8 +414,15 @@ void execute_command(Renderer* r, const RendererCommand* command)
 
         case RendererCommand::UpdateResource:
         {
-            auto data = (RenderResourceData*)command->data;
-            void* dynamic_data = command->dynamic_data;
+            auto data = (RenderResourceData*)renderer_command::data(command);
+            void* dynamic_data = renderer_command::dynamic_data(command);
+
+            if (data->type == RenderResourceData::SpriteRenderer)
+            {
+                update_sprites(r, (UpdateSpriteRendererData*)data->data, dynamic_data);
+                break;
+            }
+
             auto updated_resources = update_resources(r, data->type, data->data, dynamic_data);
 
             for (uint32 i = 0; i < updated_resources.num; ++i)
@@ -358,14 +434,14 @@ void execute_command(Renderer* r, const RendererCommand* command)
                 Assert(new_resource.type != RenderResourceType::NotInitialized, "Failed to load resource!");
 
                 if (old_resource.type == RenderResourceType::Object)
-                    memset(r->_resource_objects + handle, 0, sizeof(RendererResourceObject));
+                    clear_resource_object(r, handle);
 
                 // Map handle from outside of renderer (RenderResourceHandle) to internal handle (RenderResource).
-                render_resource_table::set(r->resource_table, handle, &new_resource);
+                render_resource_table::set(&r->resource_table, handle, &new_resource);
 
                 // Save dynamically allocated render resources in _resource_objects for deallocation on shutdown.
                 if (new_resource.type == RenderResourceType::Object)
-                    r->_resource_objects[handle] = RendererResourceObject(data->type, handle);
+                    set_resource_object(r, handle, data->type);
             }
 
             r->allocator->dealloc(updated_resources.handles);
@@ -373,9 +449,18 @@ void execute_command(Renderer* r, const RendererCommand* command)
             r->allocator->dealloc(updated_resources.old_resources);
         } break;
 
+        case RendererCommand::DestroyResource:
+        {
+            auto data = (DestroyResourceData*)renderer_command::data(command);
+            auto handles = (RenderResourceHandle*)renderer_command::dynamic_data(command);
+
+            for (uint32 i = 0; i < data->num; ++i)
+                destroy_render_resource(r, data->type, handles[i], data->world);
+        } break;
+
         case RendererCommand::Resize:
         {
-            auto data = (ResizeData*)command->data;
+            auto data = (ResizeData*)renderer_command::data(command);
             r->resolution = data->resolution;
             r->_concrete_renderer.resize(&data->resolution, r->_render_targets);
         } break;
@@ -386,17 +471,31 @@ void execute_command(Renderer* r, const RendererCommand* command)
             r->_concrete_renderer.clear();
             r->_concrete_renderer.combine_rendered_worlds(r->_rendered_worlds_combining_shader, r->_rendered_worlds, r->num_rendered_worlds);
             r->num_rendered_worlds = 0;
+            uint32 num_state_changes_issued, num_state_changes_skipped;
+            r->_concrete_renderer.state_change_stats(&num_state_changes_issued, &num_state_changes_skipped);
+            r->previous_frame_state_changes_issued.store(num_state_changes_issued, std::memory_order_relaxed);
+            r->previous_frame_state_changes_skipped.store(num_state_changes_skipped, std::memory_order_relaxed);
             flip(&r->_context, r->_context_data);
+
+            // All commands of the frame are consumed, let the main thread reuse its temp memory.
+            auto data = (CombineRenderedWorldsData*)renderer_command::data(command);
+            temp_memory::retire_frame(data->temp_memory_frame);
+            memory_telemetry::publish_render_thread_snapshot(&r->memory_snapshot, r->allocator);
+            render_interface::complete_frame(&r->render_interface, data->frame_ticket);
         } break;
 
         case RendererCommand::SetUniformValue:
         {
-            auto set_uniform_value_data = (SetUniformValueData*)command->data;
-            auto material = (RenderMaterial*)render_resource_table::lookup(r->resource_table, set_uniform_value_data->material).object;
+            auto set_uniform_value_data = (SetUniformValueData*)renderer_command::data(command);
+            auto material = (RenderMaterial*)render_resource_table::lookup(&r->resource_table, set_uniform_value_data->material).object;
             switch (set_uniform_value_data->type)
             {
             case uniform::Float:
-                render_material::set_uniform_real32_value(material, set_uniform_value_data->uniform_name, *(real32*)command->dynamic_data);
+                render_material::set_uniform_real32_value(material, set_uniform_value_data->uniform_name, *(real32*)renderer_command::dynamic_data(command));
+                break;
+            case uniform::Texture1:
+                render_material::set_uniform_uint32_value(material, set_uniform_value_data->uniform_name, *(uint32*)renderer_command::dynamic_data(command));
+                mark_render_worlds_unsorted(r);
                 break;
             default:
                 Error("Unknown uniform type");
@@ -417,13 +516,35 @@ void consume_command_queue(Renderer* r)
         r->_unprocessed_commands_exist = false;
     }
 
-    auto command = (RendererCommand*)concurrent_ring_buffer::peek(&r->_unprocessed_commands);
+    auto commands = concurrent_ring_buffer::peek_span(&r->_unprocessed_commands);
 
-    while (command != nullptr)
+    while (commands.size > 0)
     {
-        execute_command(r, command);
-        concurrent_ring_buffer::consume_one(&r->_unprocessed_commands);
-        command = (RendererCommand*)concurrent_ring_buffer::peek(&r->_unprocessed_commands);
+        // Packets never straddle the wrap of the queue, so the span holds whole packets.
+        auto command = (RendererCommand*)commands.data;
+        auto commands_end = memory::pointer_add(commands.data, commands.size * renderer_command::alignment);
+
+        uint32 num_consumed = 0;
+        auto ri = &r->render_interface;
+
+        while (command < commands_end)
+        {
+            execute_command(r, command);
+            command = (RendererCommand*)memory::pointer_add(command, command->size);
+
+            // Hand back space early if the main thread is stalled on a full queue.
+            if (ri->_waiting_for_queue_space.load(std::memory_order_relaxed))
+            {
+                auto num_executed = uint32(((uint8*)command - (uint8*)commands.data) / renderer_command::alignment);
+                concurrent_ring_buffer::consume_n(&r->_unprocessed_commands, num_executed - num_consumed);
+                num_consumed = num_executed;
+                render_interface::signal_queue_space(ri);
+            }
+        }
+
+        concurrent_ring_buffer::consume_n(&r->_unprocessed_commands, commands.size - num_consumed);
+        render_interface::signal_queue_space(ri);
+        commands = concurrent_ring_buffer::peek_span(&r->_unprocessed_commands);
     }
 }
 
@@ -438,32 +559,36 @@ void wait_for_unprocessed_commands_to_exist(Renderer* r)
 namespace renderer
 {
 
-void init(Renderer* r, const ConcreteRenderer* concrete_renderer, Allocator* renderer_allocator, const RendererContext* context)
+void init(Renderer* r, const ConcreteRenderer* concrete_renderer, Allocator* renderer_allocator, Allocator* render_interface_allocator, const RendererContext* context)
 {
     r->allocator = renderer_allocator;
     r->active = false;
     r->_concrete_renderer = *concrete_renderer;
     memset(r->_render_targets, 0, sizeof(RenderTarget) * max_render_targets);
-    memset(r->_resource_objects, 0, sizeof(RendererResourceObject) * render_resource_handle::num);
+    render_resource_table::init(&r->resource_table, r->allocator);
+    vector::init(&r->_resource_objects, r->allocator);
     r->_unprocessed_commands_exist = false;
     r->num_rendered_worlds = 0;
+    r->previous_frame_state_changes_issued = 0;
+    r->previous_frame_state_changes_skipped = 0;
     r->_context = *context;
     r->_context_data = nullptr;
-    const auto unprocessed_commands_num = 64000;
-    concurrent_ring_buffer::init(&r->_unprocessed_commands, r->allocator, unprocessed_commands_num, sizeof(RendererCommand));
-    render_interface::init(&r->render_interface, &r->_unprocessed_commands, &r->_unprocessed_commands_exist, &r->_unprocessed_commands_exist_mutex, &r->_wait_for_unprocessed_commands_to_exist);
+    const auto unprocessed_commands_size = 2097152; // 2 megabytes
+    concurrent_ring_buffer::init(&r->_unprocessed_commands, r->allocator, unprocessed_commands_size / renderer_command::alignment, renderer_command::alignment);
+    render_interface::init(&r->render_interface, render_interface_allocator, &r->_unprocessed_commands, &r->_unprocessed_commands_exist, &r->_unprocessed_commands_exist_mutex, &r->_wait_for_unprocessed_commands_to_exist);
+    memory_telemetry::publish_render_thread_snapshot(&r->memory_snapshot, r->allocator);
 }
 
 void deinit(Renderer* r)
 {    
-    for (uint32 i = 0; i < render_resource_handle::num; ++i)
+    for (uint32 i = 0; i < r->_resource_objects.size; ++i)
     {
-        auto resource_object = r->_resource_objects + i;
+        auto resource_object = &r->_resource_objects[i];
 
         if (resource_object->handle == NotInitialized)
             continue;
 
-        auto object = render_resource_table::lookup(r->resource_table, resource_object->handle).object;
+        auto object = render_resource_table::lookup(&r->resource_table, resource_object->handle).object;
 
         switch (resource_object->type)
         {
@@ -477,7 +602,9 @@ void deinit(Renderer* r)
 
         r->allocator->dealloc(object);
     }
-    
+
+    vector::deinit(&r->_resource_objects);
+    render_resource_table::deinit(&r->resource_table);
     concurrent_ring_buffer::deinit(&r->_unprocessed_commands);
 }
 
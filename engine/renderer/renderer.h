@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <condition_variable>
 #include <mutex>
 #include <thread>
@@ -13,6 +14,7 @@
 #include "render_world.h"
 #include "concrete_renderer.h"
 #include "constants.h"
+#include "../memory_telemetry.h"
 #include <os/renderer_context.h>
 
 namespace bowtie
@@ -53,21 +55,27 @@ struct Renderer
     PlatformRendererContextData* _context_data;
     RenderInterface render_interface;
     Vector2u resolution;
-    RenderResource resource_table[render_resource_handle::num];
+    RenderResourceTable resource_table;
     RenderTarget _render_targets[renderer::max_render_targets];
     RenderWorld* _rendered_worlds[renderer::max_rendered_worlds];
     uint32 num_rendered_worlds;
-    RendererResourceObject _resource_objects[render_resource_handle::num]; // Same amount of maximum resource objects as handles.
+    Vector<RendererResourceObject> _resource_objects; // Indexed like the resource table.
     RenderResource _rendered_worlds_combining_shader;
     ConcurrentRingBuffer _unprocessed_commands;
     std::mutex _unprocessed_commands_exist_mutex;
     std::condition_variable _wait_for_unprocessed_commands_to_exist;
     bool _unprocessed_commands_exist;
+    RenderThreadMemorySnapshot memory_snapshot; // Published at the end of every rendered frame.
+
+    // State changes of the previous rendered frame which the concrete renderer issued or found redundant and skipped.
+    std::atomic<uint32> previous_frame_state_changes_issued;
+    std::atomic<uint32> previous_frame_state_changes_skipped;
 };
 
 namespace renderer
 {
-    void init(Renderer* r, const ConcreteRenderer* concrete_renderer_obj, Allocator* renderer_allocator, const RendererContext* context);
+    // render_interface_allocator is used by the main thread side of the render interface, it must be thread safe.
+    void init(Renderer* r, const ConcreteRenderer* concrete_renderer_obj, Allocator* renderer_allocator, Allocator* render_interface_allocator, const RendererContext* context);
     void deinit(Renderer* r);
     void process_command_queue(Renderer* renderer);
     void setup(Renderer* r, PlatformRendererContextData* context, const Vector2u* resolution);
@@ -5,17 +5,32 @@
 #include <base/vector2u.h>
 #include <base/vector4.h>
 #include <base/matrix4.h>
+#include <base/memory.h>
 
 namespace bowtie
 {
 
+namespace renderer_command
+{
+    // Commands are packets in the command queue: this header, the data and then the dynamic data,
+    // each part padded to alignment.
+    static const uint32 alignment = 8;
+
+    // Larger dynamic data is put in temp memory instead of in the packet.
+    static const uint32 max_inline_dynamic_data_size = 262144; // 256 kilobytes
+}
+
 struct RendererCommand
 {
-    enum Type { Fence, RenderWorld, LoadResource, UpdateResource, Resize, CombineRenderedWorlds, SetUniformValue };
+    enum Type { Padding, Fence, RenderWorld, LoadResource, UpdateResource, DestroyResource, Resize, CombineRenderedWorlds, SetUniformValue };
+
+    // Padding packets, which fill the end of the queue when a packet doesn't fit before it wraps,
+    // only have type and size.
     Type type;
-    void* data;
+    uint32 size; // In bytes, including header.
+    uint32 data_size;
     uint32 dynamic_data_size;
-    void* dynamic_data;
+    void* external_dynamic_data;
 };
 
 struct RenderWorldData
@@ -25,6 +40,12 @@ struct RenderWorldData
     real32 time;
 };
 
+struct CombineRenderedWorldsData
+{
+    uint64 temp_memory_frame;
+    uint64 frame_ticket;
+};
+
 struct ResizeData
 {
     Vector2u resolution;
@@ -37,4 +58,25 @@ struct SetUniformValueData
     uint64 uniform_name;
 };
 
+namespace renderer_command
+{
+    inline uint32 padded_size(uint32 size)
+    {
+        return (size + alignment - 1) & ~(alignment - 1);
+    }
+
+    inline void* data(RendererCommand* command)
+    {
+        return memory::pointer_add(command, padded_size(sizeof(RendererCommand)));
+    }
+
+    inline void* dynamic_data(RendererCommand* command)
+    {
+        if (command->external_dynamic_data != nullptr)
+            return command->external_dynamic_data;
+
+        return memory::pointer_add(data(command), padded_size(command->data_size));
+    }
+}
+
 }
\ No newline at end of file
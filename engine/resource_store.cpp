@@ -8,6 +8,7 @@
 #include <base/jzon.h>
 #include <base/string_utils.h>
 #include <base/stream.h>
+#include <base/vector.h>
 #include <base/resource_path.h>
 
 #include "font.h"
@@ -60,6 +61,14 @@ void add(Hash<void*>* resources, uint64 name, ResourceType type, void* resource)
     hash::set(resources, get_name(name, type), resource);
 }
 
+void add_render_resource(ResourceStore* rs, RenderResourceData::Type type, RenderResourceHandle handle)
+{
+    LoadedRenderResource lrr;
+    lrr.type = type;
+    lrr.handle = handle;
+    vector::push(&rs->_render_resources, lrr);
+}
+
 uniform::Type get_uniform_type_from_str(const char* str)
 {
     static const char* types_as_str[] = { "float", "vec2", "vec3", "vec4", "mat3", "mat4", "texture1", "texture2", "texture3" };
@@ -148,6 +157,7 @@ Shader* load_shader(ResourceStore* rs, const char* filename)
     auto shader = (Shader*)debug_memory::alloc(sizeof(Shader));
     shader->render_handle = resource_package.data.handle;
     add(&rs->_resources, name, ResourceType::Shader, shader);
+    add_render_resource(rs, RenderResourceData::Shader, shader->render_handle);
     return shader;
 }
 
@@ -183,6 +193,7 @@ Texture* load_texture(ResourceStore* rs, const char* filename)
     texture->render_handle = RenderResourceHandle();
     render_interface::create_texture(rs->render_interface, texture);
     add(&rs->_resources, name, ResourceType::Texture, texture);
+    add_render_resource(rs, RenderResourceData::Texture, texture->render_handle);
     return texture;
 }
 
@@ -272,6 +283,7 @@ Material* load_material(ResourceStore* rs, const char* filename)
     material->render_handle = mrd.handle;
     material->shader = shader;
     add(&rs->_resources, name, ResourceType::Material, material);
+    add_render_resource(rs, RenderResourceData::RenderMaterial, material->render_handle);
     jzon_free_custom_allocator(jzon, &jzon_allocator);
     return material;
 }
@@ -327,12 +339,22 @@ void init(ResourceStore* rs, Allocator* allocator, RenderInterface* render_inter
     rs->render_interface = render_interface;
     memset(rs->_default_resources, 0, sizeof(Option<void*>) * (uint32)ResourceType::NumResourceTypes);
     hash::init<void*>(&rs->_resources, rs->allocator);
+    vector::init(&rs->_render_resources, rs->allocator);
     jzon_allocator.allocate = jzon_static_allocate;
     jzon_allocator.deallocate = jzon_static_deallocate;
 }
 
 void deinit(ResourceStore* rs)
 {
+    // Reverse load order, so that materials go before their shaders and textures.
+    for (uint32 i = rs->_render_resources.size; i > 0; --i)
+    {
+        auto lrr = rs->_render_resources[i - 1];
+        render_interface::destroy_resource(rs->render_interface, lrr.type, lrr.handle);
+    }
+
+    vector::deinit(&rs->_render_resources);
+
     for(auto resource_iter = hash::begin(&rs->_resources); resource_iter != hash::end(&rs->_resources); ++resource_iter)
         debug_memory::dealloc(resource_iter->value);
 
@@ -3,6 +3,7 @@
 #include <base/murmur_hash.h>
 #include <base/string_utils.h>
 #include "renderer/render_resource_handle.h"
+#include "renderer/render_resource_types.h"
 #include "resource_type.h"
 
 namespace bowtie
@@ -14,11 +15,18 @@ struct Image;
 struct Shader;
 struct Font;
 
+struct LoadedRenderResource
+{
+    RenderResourceData::Type type;
+    RenderResourceHandle handle;
+};
+
 struct ResourceStore
 {
     Allocator* allocator;
     RenderInterface* render_interface;
     Hash<void*> _resources;
+    Vector<LoadedRenderResource> _render_resources; // In load order, so resources come after the ones they use.
     Option<void*> _default_resources[(uint32)ResourceType::NumResourceTypes];
 };
 
@@ -28,6 +36,7 @@ namespace resource_store
     ResourceType resource_type_from_string(const char* type);
 
     void init(ResourceStore* rs, Allocator* allocator, RenderInterface* render_interface);
+    // Also destroys the render resources, which happens when the render interface's command lists are next submitted.
     void deinit(ResourceStore* rs);
     Option<void*> load(ResourceStore* rs, ResourceType type, const char* filename);
     Option<void*> get(const ResourceStore* rs, ResourceType type, uint64 name);
@@ -88,16 +88,22 @@ void create_sprites(RenderInterface* ri, RenderResourceHandle default_material,
     data.num = num;
     data.world = render_world;
     rrd.data = &data;
-    render_interface::create_resource(ri, &rrd, sprite_renderer_component::copy_new_data(sprite_renderer), sprite_renderer_component::component_size * data.num);
+    auto command = render_interface::begin_create_resource(ri, &rrd, sprite_renderer_component::component_size * data.num);
+    sprite_renderer_component::copy_new_data(sprite_renderer, renderer_command::dynamic_data(command));
+    render_interface::end_command(ri, command);
 }
 
-void update_sprites(RenderInterface* ri, SpriteRendererComponent* sprite_renderer, uint32 num)
+void update_sprites(RenderInterface* ri, RenderResourceHandle render_world, SpriteRendererComponent* sprite_renderer, uint32 num)
 {
     auto rrd = render_resource_data::create(RenderResourceData::SpriteRenderer);
     UpdateSpriteRendererData data;
+    data.world = render_world;
     data.num = num;
+    data.fields = sprite_renderer->dirty_fields;
     rrd.data = &data;
-    render_interface::update_resource(ri, &rrd, sprite_renderer_component::copy_dirty_data(sprite_renderer), sprite_renderer_component::component_size * data.num);
+    auto command = render_interface::begin_update_resource(ri, &rrd, sprite_renderer_component::dirty_data_size(sprite_renderer));
+    sprite_renderer_component::copy_dirty_data(sprite_renderer, renderer_command::dynamic_data(command));
+    render_interface::end_command(ri, command);
 }
 
 } // anonymous namespace
@@ -146,24 +152,22 @@ void update(World* w)
     {
         const auto num_dirty_sprites = component::num_dirty(&w->sprite_renderer_components.header);
 
-        if (num_dirty_sprites > 0)
-            update_sprites(w->render_interface, &w->sprite_renderer_components, num_dirty_sprites);
+        if (num_dirty_sprites > 0 && w->sprite_renderer_components.dirty_fields != 0)
+            update_sprites(w->render_interface, w->render_handle, &w->sprite_renderer_components, num_dirty_sprites);
     
-        component::reset_dirty(&w->sprite_renderer_components.header);
+        sprite_renderer_component::reset_dirty(&w->sprite_renderer_components);
     }
 }
 
 void draw(World* w, const Rect* view, real32 time)
 {
-    auto render_world_command = render_interface::create_command(RendererCommand::RenderWorld);
-
-    auto rwd = (RenderWorldData*)temp_memory::alloc(sizeof(RenderWorldData));
-    rwd->view = *view;
-    rwd->render_world = w->render_handle;
-    rwd->time = time;
-    render_world_command.data = rwd;
-
-    render_interface::dispatch(w->render_interface, &render_world_command);
+    RenderWorldData rwd;
+    rwd.view = *view;
+    rwd.render_world = w->render_handle;
+    rwd.time = time;
+    auto cl = render_interface::thread_command_list(w->render_interface);
+    auto view_order = render_interface::next_view(w->render_interface);
+    command_list::record(cl, command_list::sort_key(view_order, 0, 0), RendererCommand::RenderWorld, &rwd, sizeof(RenderWorldData));
 }
 
 } // namespace world
@@ -19,6 +19,7 @@ struct World
     RenderResourceHandle render_handle;
     RenderInterface* render_interface;
     RenderResourceHandle default_material;
+    uint32 permanent_memory_marker; // Index of the marker pushed by engine::create_world.
     TransformComponent transform_components;
     SpriteRendererComponent sprite_renderer_components;
 };
@@ -27,6 +28,9 @@ namespace world
 {
     void init(World* w, Allocator* allocator, RenderInterface* render_interface, ResourceStore* resource_store);
     void update(World* w);
+    // Records the draw into the calling thread's command list, it's executed once the lists are
+    // submitted. Sprite and uniform changes dispatched before that show up in it. Worlds are
+    // composited in the order they are drawn.
     void draw(World* w, const Rect* view, real32 time);
 }
 
@@ -0,0 +1,298 @@
+#include "gl_state_cache.h"
+#include <engine/renderer/render_uniform.h>
+#include <cstring>
+
+namespace bowtie
+{
+
+namespace internal
+{
+
+uint32 gl_buffer_target_index(GLenum target)
+{
+    switch (target)
+    {
+    case GL_ARRAY_BUFFER: return 0;
+    case GL_COPY_READ_BUFFER: return 1;
+    case GL_COPY_WRITE_BUFFER: return 2;
+    default: Error("Buffer target not handled by state cache"); return 0;
+    }
+}
+
+GLProgramUniforms* gl_program_uniforms(GLStateCache* c, GLuint program)
+{
+    for (uint32 i = 0; i < c->num_program_uniforms; ++i)
+    {
+        if (c->program_uniforms[i].program == program)
+            return c->program_uniforms + i;
+    }
+
+    GLProgramUniforms* pu;
+
+    if (c->num_program_uniforms < gl_state_cache::max_programs)
+        pu = c->program_uniforms + c->num_program_uniforms++;
+    else
+    {
+        pu = c->program_uniforms + c->next_evicted_program_uniforms;
+        c->next_evicted_program_uniforms = (c->next_evicted_program_uniforms + 1) % gl_state_cache::max_programs;
+    }
+
+    pu->program = program;
+    pu->set_locations = 0;
+    return pu;
+}
+
+// Returns false and counts a skipped call if location of the current program already has value.
+bool gl_uniform_changed(GLStateCache* c, GLint location, const void* value, uint32 size)
+{
+    if (location < 0 || c->program == 0 || (uint32)location >= gl_state_cache::max_uniform_locations)
+    {
+        ++c->num_issued;
+        return true;
+    }
+
+    auto pu = gl_program_uniforms(c, c->program);
+    auto bit = 1u << location;
+    auto shadow = pu->values[location];
+
+    if ((pu->set_locations & bit) != 0 && memcmp(shadow, value, size) == 0)
+    {
+        ++c->num_skipped;
+        return false;
+    }
+
+    memcpy(shadow, value, size);
+    pu->set_locations |= bit;
+    ++c->num_issued;
+    return true;
+}
+
+} // namespace internal
+
+namespace gl_state_cache
+{
+
+void init(GLStateCache* c)
+{
+    memset(c, 0, sizeof(GLStateCache));
+}
+
+void end_frame(GLStateCache* c)
+{
+    c->previous_frame_num_issued = c->num_issued;
+    c->previous_frame_num_skipped = c->num_skipped;
+    c->num_issued = 0;
+    c->num_skipped = 0;
+}
+
+void use_program(GLStateCache* c, GLuint program)
+{
+    if (c->program == program)
+    {
+        ++c->num_skipped;
+        return;
+    }
+
+    glUseProgram(program);
+    c->program = program;
+    ++c->num_issued;
+}
+
+void bind_texture(GLStateCache* c, uint32 unit, GLuint texture)
+{
+    Assert(unit < max_texture_units, "Texture unit out of range");
+
+    if (c->textures[unit] == texture)
+    {
+        ++c->num_skipped;
+        return;
+    }
+
+    if (c->active_texture_unit != unit)
+    {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        c->active_texture_unit = unit;
+        ++c->num_issued;
+    }
+
+    glBindTexture(GL_TEXTURE_2D, texture);
+    c->textures[unit] = texture;
+    ++c->num_issued;
+}
+
+void bind_buffer(GLStateCache* c, GLenum target, GLuint buffer)
+{
+    auto bound = c->buffers + internal::gl_buffer_target_index(target);
+
+    if (*bound == buffer)
+    {
+        ++c->num_skipped;
+        return;
+    }
+
+    glBindBuffer(target, buffer);
+    *bound = buffer;
+    ++c->num_issued;
+}
+
+void bind_uniform_buffer(GLStateCache* c, uint32 binding, GLuint buffer)
+{
+    Assert(binding < max_uniform_buffer_bindings, "Uniform buffer binding out of range");
+
+    if (c->uniform_buffers[binding] == buffer)
+    {
+        ++c->num_skipped;
+        return;
+    }
+
+    glBindBufferBase(GL_UNIFORM_BUFFER, binding, buffer);
+    c->uniform_buffers[binding] = buffer;
+    ++c->num_issued;
+}
+
+void set_blend(GLStateCache* c, bool enabled, GLenum source, GLenum destination)
+{
+    if (c->blend_enabled != enabled)
+    {
+        if (enabled)
+            glEnable(GL_BLEND);
+        else
+            glDisable(GL_BLEND);
+
+        c->blend_enabled = enabled;
+        ++c->num_issued;
+    }
+    else
+        ++c->num_skipped;
+
+    if (c->blend_source == source && c->blend_destination == destination)
+    {
+        ++c->num_skipped;
+        return;
+    }
+
+    glBlendFunc(source, destination);
+    c->blend_source = source;
+    c->blend_destination = destination;
+    ++c->num_issued;
+}
+
+void enable_vertex_attributes(GLStateCache* c, uint32 mask)
+{
+    auto changed = c->enabled_vertex_attributes ^ mask;
+
+    for (uint32 i = 0; i < max_vertex_attributes; ++i)
+    {
+        auto bit = 1u << i;
+
+        if ((changed & bit) == 0)
+            continue;
+
+        if ((mask & bit) != 0)
+            glEnableVertexAttribArray(i);
+        else
+            glDisableVertexAttribArray(i);
+
+        ++c->num_issued;
+    }
+
+    if (changed == 0)
+        ++c->num_skipped;
+
+    c->enabled_vertex_attributes = mask;
+}
+
+void vertex_attribute(GLStateCache* c, uint32 index, GLuint buffer, GLint size, GLenum type, GLboolean normalized, GLsizei stride, uintptr_t offset)
+{
+    Assert(index < max_vertex_attributes, "Vertex attribute out of range");
+    auto a = c->vertex_attributes + index;
+
+    if (a->buffer == buffer && a->size == size && a->type == type && a->normalized == normalized && a->stride == stride && a->offset == offset)
+    {
+        ++c->num_skipped;
+        return;
+    }
+
+    bind_buffer(c, GL_ARRAY_BUFFER, buffer);
+    glVertexAttribPointer(index, size, type, normalized, stride, (void*)offset);
+    a->buffer = buffer;
+    a->size = size;
+    a->type = type;
+    a->normalized = normalized;
+    a->stride = stride;
+    a->offset = offset;
+    ++c->num_issued;
+}
+
+void set_uniform(GLStateCache* c, GLint location, uniform::Type type, const void* value)
+{
+    if (!internal::gl_uniform_changed(c, location, value, render_uniform::value_size(type)))
+        return;
+
+    switch (type)
+    {
+    case uniform::Float: glUniform1fv(location, 1, (const GLfloat*)value); break;
+    case uniform::Vec2: glUniform2fv(location, 1, (const GLfloat*)value); break;
+    case uniform::Vec3: glUniform3fv(location, 1, (const GLfloat*)value); break;
+    case uniform::Vec4: glUniform4fv(location, 1, (const GLfloat*)value); break;
+    case uniform::Mat3: glUniformMatrix3fv(location, 1, GL_FALSE, (const GLfloat*)value); break;
+    case uniform::Mat4: glUniformMatrix4fv(location, 1, GL_FALSE, (const GLfloat*)value); break;
+    case uniform::Texture1:
+    case uniform::Texture2:
+    case uniform::Texture3: glUniform1i(location, *(const GLint*)value); break;
+    default: Error("Unknown uniform type"); break;
+    }
+}
+
+void set_uniform_int(GLStateCache* c, GLint location, int32 value)
+{
+    if (internal::gl_uniform_changed(c, location, &value, sizeof(int32)))
+        glUniform1i(location, value);
+}
+
+void forget_program(GLStateCache* c, GLuint program)
+{
+    for (uint32 i = 0; i < c->num_program_uniforms; ++i)
+    {
+        if (c->program_uniforms[i].program == program)
+            c->program_uniforms[i].set_locations = 0;
+    }
+
+    // A deleted program lives on while it's current, unbind it so that the name can be recycled.
+    if (c->program == program)
+        use_program(c, 0);
+}
+
+void forget_texture(GLStateCache* c, GLuint texture)
+{
+    for (uint32 i = 0; i < max_texture_units; ++i)
+    {
+        if (c->textures[i] == texture)
+            c->textures[i] = 0;
+    }
+}
+
+void forget_buffer(GLStateCache* c, GLuint buffer)
+{
+    for (uint32 i = 0; i < num_buffer_targets; ++i)
+    {
+        if (c->buffers[i] == buffer)
+            c->buffers[i] = 0;
+    }
+
+    for (uint32 i = 0; i < max_uniform_buffer_bindings; ++i)
+    {
+        if (c->uniform_buffers[i] == buffer)
+            c->uniform_buffers[i] = 0;
+    }
+
+    for (uint32 i = 0; i < max_vertex_attributes; ++i)
+    {
+        if (c->vertex_attributes[i].buffer == buffer)
+            memset(c->vertex_attributes + i, 0, sizeof(GLVertexAttribute));
+    }
+}
+
+} // namespace gl_state_cache
+
+} // namespace bowtie
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <engine/renderer/uniform.h>
+#include "gl3w.h"
+
+namespace bowtie
+{
+
+namespace gl_state_cache
+{
+    const uint32 max_texture_units = 16;
+    const uint32 max_vertex_attributes = 8;
+    const uint32 max_programs = 32;
+    const uint32 max_uniform_locations = 32;
+    const uint32 max_uniform_value_size = 64; // Big enough for a mat4.
+    const uint32 num_buffer_targets = 3; // GL_ARRAY_BUFFER, GL_COPY_READ_BUFFER and GL_COPY_WRITE_BUFFER.
+    const uint32 max_uniform_buffer_bindings = 4;
+}
+
+struct GLVertexAttribute
+{
+    GLuint buffer;
+    GLint size;
+    GLenum type;
+    GLboolean normalized;
+    GLsizei stride;
+    uintptr_t offset;
+};
+
+// Last uniform values set on a program, uniforms at locations past max_uniform_locations aren't shadowed.
+struct GLProgramUniforms
+{
+    GLuint program;
+    uint32 set_locations; // One bit per location that has a shadowed value.
+    uint8 values[gl_state_cache::max_uniform_locations][gl_state_cache::max_uniform_value_size];
+};
+
+// Mirrors the GL state the renderer sets, calls that wouldn't change anything are skipped. Only valid
+// as long as all state changes go through it.
+struct GLStateCache
+{
+    GLuint program;
+    uint32 active_texture_unit;
+    GLuint textures[gl_state_cache::max_texture_units];
+    GLuint buffers[gl_state_cache::num_buffer_targets];
+    GLuint uniform_buffers[gl_state_cache::max_uniform_buffer_bindings];
+    uint32 enabled_vertex_attributes; // One bit per attribute.
+    GLVertexAttribute vertex_attributes[gl_state_cache::max_vertex_attributes];
+    bool blend_enabled;
+    GLenum blend_source;
+    GLenum blend_destination;
+    GLProgramUniforms program_uniforms[gl_state_cache::max_programs];
+    uint32 num_program_uniforms;
+    uint32 next_evicted_program_uniforms;
+
+    uint32 num_issued;
+    uint32 num_skipped;
+    uint32 previous_frame_num_issued;
+    uint32 previous_frame_num_skipped;
+};
+
+namespace gl_state_cache
+{
+    void init(GLStateCache* c);
+    void end_frame(GLStateCache* c);
+
+    void use_program(GLStateCache* c, GLuint program);
+    void bind_texture(GLStateCache* c, uint32 unit, GLuint texture);
+    void bind_buffer(GLStateCache* c, GLenum target, GLuint buffer);
+    void bind_uniform_buffer(GLStateCache* c, uint32 binding, GLuint buffer);
+    void set_blend(GLStateCache* c, bool enabled, GLenum source, GLenum destination);
+
+    // Enables the attributes whose bits are set in mask and disables the rest.
+    void enable_vertex_attributes(GLStateCache* c, uint32 mask);
+    void vertex_attribute(GLStateCache* c, uint32 index, GLuint buffer, GLint size, GLenum type, GLboolean normalized, GLsizei stride, uintptr_t offset);
+
+    // Sets a uniform of the current program. Texture uniforms take the texture unit as a uint32.
+    void set_uniform(GLStateCache* c, GLint location, uniform::Type type, const void* value);
+    void set_uniform_int(GLStateCache* c, GLint location, int32 value);
+
+    // Call before deleting GL objects, so that a recycled name isn't mistaken for the deleted one.
+    void forget_program(GLStateCache* c, GLuint program);
+    void forget_texture(GLStateCache* c, GLuint texture);
+    void forget_buffer(GLStateCache* c, GLuint buffer);
+}
+
+}
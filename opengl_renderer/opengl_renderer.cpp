@@ -4,7 +4,7 @@
 #include <engine/view.h>
 #include <engine/rect.h>
 #include <engine/timer.h>
-#include <engine/renderer/render_component.h>
+#include <base/quad.h>
 #include <engine/renderer/render_material.h>
 #include <engine/renderer/render_target.h>
 #include <engine/renderer/render_texture.h>
@@ -12,6 +12,8 @@
 #include <engine/renderer/render_resource_table.h>
 #include <engine/renderer/constants.h>
 #include "gl3w.h"
+#include "gl_state_cache.h"
+#include <cstddef>
 
 namespace bowtie
 {
@@ -46,6 +48,142 @@ GLPixelFormat gl_pixel_format(PixelFormat pixel_format)
     return gl_pixel_format;
 }
 
+// Vertices are streamed through one buffer split into regions, the renderer moves to the next region
+// every frame. When the buffer can be persistently mapped, a region is written again only after the
+// fence placed when leaving it has passed. Otherwise each write maps its range unsynchronized and the
+// buffer is orphaned when wrapping around to the first region.
+const uint32 streaming_vertex_buffer_num_regions = 3;
+const uint32 streaming_vertex_buffer_region_size = 8388608; // 8 megabytes
+
+struct StreamingVertexBuffer
+{
+    GLuint buffer;
+    uint8* persistent_data; // Null if persistent mapping isn't supported.
+    uint32 region;
+    uint32 region_offset;
+    GLsync region_fences[streaming_vertex_buffer_num_regions];
+};
+
+// Shaders get the automatic uniforms from the view_uniforms block and their constant uniforms from the
+// material_uniforms block, both std140. ViewUniforms is written once per drawn world.
+const uint32 view_uniforms_binding = 0;
+const uint32 material_uniforms_binding = 1;
+const uint32 max_material_uniform_buffer_size = 1024;
+
+struct ViewUniforms
+{
+    Matrix4 model_view_projection_matrix;
+    Matrix4 model_view_matrix;
+    Matrix4 model_matrix;
+    Vector2 view_resolution;
+    Vector2 resolution;
+    real32 time;
+    real32 view_resolution_ratio;
+    real32 padding[2];
+};
+
+static_assert(sizeof(ViewUniforms) == 224, "ViewUniforms doesn't match the std140 layout of view_uniforms");
+
+GLStateCache gl_state;
+GLuint view_uniform_buffer;
+StreamingVertexBuffer streaming_vertex_buffer;
+GLuint fullscreen_quad;
+
+// Sprites are drawn as instances of a unit quad, which the vertex shader maps onto the sprite's corners.
+// Attribute 0 is the unit quad corner, 1 and 2 are the sprite's corners, 3 the color and 4 the UV rect.
+GLuint unit_quad;
+
+struct SpriteInstance
+{
+    real32 corners[8];
+    uint32 color; // RGBA8
+    uint16 uv_rect[4]; // Position and size, normalized.
+};
+
+uint32 pack_color(const Color* color)
+{
+    auto channel = [](real32 c) { return uint32((c < 0.0f ? 0.0f : (c > 1.0f ? 1.0f : c)) * 255.0f + 0.5f); };
+    return channel(color->r) | (channel(color->g) << 8) | (channel(color->b) << 16) | (channel(color->a) << 24);
+}
+
+void init_streaming_vertex_buffer(StreamingVertexBuffer* svb)
+{
+    memset(svb, 0, sizeof(StreamingVertexBuffer));
+    const auto size = streaming_vertex_buffer_region_size * streaming_vertex_buffer_num_regions;
+    glGenBuffers(1, &svb->buffer);
+    gl_state_cache::bind_buffer(&gl_state, GL_ARRAY_BUFFER, svb->buffer);
+
+    if (glBufferStorage == nullptr)
+    {
+        glBufferData(GL_ARRAY_BUFFER, size, nullptr, GL_STREAM_DRAW);
+        return;
+    }
+
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glBufferStorage(GL_ARRAY_BUFFER, size, nullptr, flags);
+    svb->persistent_data = (uint8*)glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags);
+    Assert(svb->persistent_data != nullptr, "Failed mapping streaming vertex buffer");
+}
+
+void next_streaming_vertex_buffer_region(StreamingVertexBuffer* svb)
+{
+    auto next_region = (svb->region + 1) % streaming_vertex_buffer_num_regions;
+    svb->region_offset = 0;
+
+    if (svb->persistent_data == nullptr)
+    {
+        svb->region = next_region;
+
+        if (next_region == 0)
+        {
+            gl_state_cache::bind_buffer(&gl_state, GL_ARRAY_BUFFER, svb->buffer);
+            glBufferData(GL_ARRAY_BUFFER, streaming_vertex_buffer_region_size * streaming_vertex_buffer_num_regions, nullptr, GL_STREAM_DRAW);
+        }
+
+        return;
+    }
+
+    svb->region_fences[svb->region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    svb->region = next_region;
+    auto fence = svb->region_fences[next_region];
+
+    if (fence == nullptr)
+        return;
+
+    while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED)
+        ;
+
+    glDeleteSync(fence);
+    svb->region_fences[next_region] = nullptr;
+}
+
+// Returns where to write size bytes of vertices. offset is set to where they are in the buffer.
+void* begin_streaming_vertices(StreamingVertexBuffer* svb, uint32 size, uint32* offset)
+{
+    Assert(size <= streaming_vertex_buffer_region_size, "Trying to stream more vertices than fit in a streaming vertex buffer region");
+
+    if (svb->region_offset + size > streaming_vertex_buffer_region_size)
+        next_streaming_vertex_buffer_region(svb);
+
+    *offset = svb->region * streaming_vertex_buffer_region_size + svb->region_offset;
+    svb->region_offset += size;
+
+    if (svb->persistent_data != nullptr)
+        return svb->persistent_data + *offset;
+
+    gl_state_cache::bind_buffer(&gl_state, GL_ARRAY_BUFFER, svb->buffer);
+    return glMapBufferRange(GL_ARRAY_BUFFER, *offset, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+}
+
+void end_streaming_vertices(StreamingVertexBuffer* svb)
+{
+    if (svb->persistent_data != nullptr)
+        return;
+
+    gl_state_cache::bind_buffer(&gl_state, GL_ARRAY_BUFFER, svb->buffer);
+    glUnmapBuffer(GL_ARRAY_BUFFER);
+}
+
 void clear()
 {
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -55,31 +193,21 @@ GLuint create_geometry_internal(void* data, uint32 data_size)
 {
     GLuint geometry_buffer;
     glGenBuffers(1, &geometry_buffer);
-    glBindBuffer(GL_ARRAY_BUFFER, geometry_buffer);
+    gl_state_cache::bind_buffer(&gl_state, GL_ARRAY_BUFFER, geometry_buffer);
     glBufferData(GL_ARRAY_BUFFER, data_size, data, GL_STATIC_DRAW);
     return geometry_buffer;
 }
 
 void destroy_geometry_internal(GLuint handle)
 {
+    gl_state_cache::forget_buffer(&gl_state, handle);
     glDeleteBuffers(1, &handle);
 }
 
 void combine_rendered_worlds(RenderResource rendered_worlds_combining_shader, RenderWorld** rendered_worlds, uint32 num_rendered_worlds)
 {
     auto shader = rendered_worlds_combining_shader.handle;
-
-    static const real32 fullscreen_quad_data[] = {
-        -1.0f, -1.0f, 0.0f,
-        1.0f, -1.0f, 0.0f,
-        -1.0f, 1.0f, 0.0f,
-        -1.0f, 1.0f, 0.0f,
-        1.0f, -1.0f, 0.0f,
-        1.0f, 1.0f, 0.0f,
-    };
-
-    auto quad = create_geometry_internal((void*)fullscreen_quad_data, sizeof(fullscreen_quad_data));
-    glUseProgram(shader);
+    gl_state_cache::use_program(&gl_state, shader);
     Assert(num_rendered_worlds <= renderer::max_rendered_worlds, "Rendered too many worlds");
     GLuint texture_sampler_id = glGetUniformLocation(shader, "texture_samplers");
 
@@ -87,28 +215,25 @@ void combine_rendered_worlds(RenderResource rendered_worlds_combining_shader, Re
     {
         auto rw = rendered_worlds[i];
 
-        glActiveTexture(GL_TEXTURE0 + i);
-        glBindTexture(GL_TEXTURE_2D, rw->render_target.texture.render_handle.handle);
-        glUniform1i(texture_sampler_id, i);
+        gl_state_cache::bind_texture(&gl_state, i, rw->render_target->texture.render_handle.handle);
+        gl_state_cache::set_uniform_int(&gl_state, texture_sampler_id, i);
     }
 
     GLuint num_samplers_id = glGetUniformLocation(shader, "num_samplers");
-    glUniform1i(num_samplers_id, num_rendered_worlds);
-
-    glBindBuffer(GL_ARRAY_BUFFER, quad);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(
-        0,
-        3,
-        GL_FLOAT,
-        GL_FALSE,
-        0,
-        (void*)0
-        );
-
+    gl_state_cache::set_uniform_int(&gl_state, num_samplers_id, num_rendered_worlds);
+    gl_state_cache::enable_vertex_attributes(&gl_state, 1);
+    gl_state_cache::vertex_attribute(&gl_state, 0, fullscreen_quad, 3, GL_FLOAT, GL_FALSE, 0, 0);
     glDrawArrays(GL_TRIANGLES, 0, 6);
-    glDisableVertexAttribArray(0);
-    destroy_geometry_internal(quad);
+
+    // This is the last draw of the frame.
+    next_streaming_vertex_buffer_region(&streaming_vertex_buffer);
+    gl_state_cache::end_frame(&gl_state);
+}
+
+void state_change_stats(uint32* num_issued, uint32* num_skipped)
+{
+    *num_issued = gl_state.previous_frame_num_issued;
+    *num_skipped = gl_state.previous_frame_num_skipped;
 }
 
 RenderResource create_geometry(void* data, uint32 data_size)
@@ -118,7 +243,6 @@ RenderResource create_geometry(void* data, uint32 data_size)
 
 GLuint create_render_target_internal(GLuint texture_id)
 {
-    glBindTexture(GL_TEXTURE_2D, texture_id);
     GLuint fb = 0;
     glGenFramebuffers(1, &fb);
     glBindFramebuffer(GL_FRAMEBUFFER, fb);
@@ -194,6 +318,15 @@ RenderResource create_shader(const char* vertex_source, const char* fragment_sou
     }
 
     Assert(program != 0, "Failed to link glsl shader");
+    auto view_uniforms_index = glGetUniformBlockIndex(program, "view_uniforms");
+    auto material_uniforms_index = glGetUniformBlockIndex(program, "material_uniforms");
+
+    if (view_uniforms_index != GL_INVALID_INDEX)
+        glUniformBlockBinding(program, view_uniforms_index, view_uniforms_binding);
+
+    if (material_uniforms_index != GL_INVALID_INDEX)
+        glUniformBlockBinding(program, material_uniforms_index, material_uniforms_binding);
+
     return render_resource::create_handle(program);
 }
 
@@ -201,7 +334,7 @@ GLuint create_texture_internal(PixelFormat pf, const Vector2u* resolution, void*
 {
     GLuint texture_id;
     glGenTextures(1, &texture_id);
-    glBindTexture(GL_TEXTURE_2D, texture_id);
+    gl_state_cache::bind_texture(&gl_state, gl_state.active_texture_unit, texture_id);
     auto pixel_format = gl_pixel_format(pf);
     glTexImage2D(GL_TEXTURE_2D, 0, pixel_format.internal_format, resolution->x, resolution->y, 0, pixel_format.format, GL_UNSIGNED_BYTE, data);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
@@ -222,11 +355,13 @@ void destroy_geometry(RenderResource handle)
 void destroy_texture(RenderResource texture)
 {
     auto rt = (RenderTexture*)texture.object;
+    gl_state_cache::forget_texture(&gl_state, rt->render_handle.handle);
     glDeleteTextures(1, &rt->render_handle.handle);
 }
 
 void destroy_render_target_internal(const RenderTarget* render_target)
 {
+    gl_state_cache::forget_texture(&gl_state, render_target->texture.render_handle.handle);
     glDeleteTextures(1, &render_target->texture.render_handle.handle);
     glDeleteFramebuffers(1, &render_target->handle.handle);
 }
@@ -236,186 +371,238 @@ void destroy_render_target(RenderResource render_target)
     destroy_render_target_internal((RenderTarget*)render_target.object);
 }
 
-void draw_batch(uint32 start, uint32 size, RenderComponent** components, const Vector2u* resolution, const Rect* view,
-                const Matrix4* view_matrix, const Matrix4* view_projection_matrix, real32 time, const RenderResource* resource_table)
+void destroy_gpu_sprites(RenderResource gpu_sprites)
+{
+    gl_state_cache::forget_buffer(&gl_state, gpu_sprites.handle);
+    glDeleteBuffers(1, &gpu_sprites.handle);
+}
+
+void destroy_uniform_buffer(RenderResource uniform_buffer)
+{
+    gl_state_cache::forget_buffer(&gl_state, uniform_buffer.handle);
+    glDeleteBuffers(1, &uniform_buffer.handle);
+}
+
+void upload_material_uniforms(RenderMaterial* material)
+{
+    auto size = material->uniform_buffer_size;
+    Assert(size <= max_material_uniform_buffer_size, "Material uniform buffer too big");
+    uint8 data[max_material_uniform_buffer_size];
+    memset(data, 0, size);
+
+    for (uint32 i = 0; i < material->num_uniforms; ++i)
+    {
+        auto uniform = material->uniforms + i;
+
+        if (uniform->buffer_offset == render_uniform::not_in_buffer)
+            continue;
+
+        auto value_size = render_uniform::value_size(uniform->type);
+        Assert(value_size <= sizeof(uniform->value) && uniform->buffer_offset + value_size <= size, "Material uniform doesn't fit its buffer");
+        memcpy(data + uniform->buffer_offset, uniform->value, value_size);
+    }
+
+    if (material->uniform_buffer.type == RenderResourceType::NotInitialized)
+    {
+        GLuint buffer;
+        glGenBuffers(1, &buffer);
+        gl_state_cache::bind_buffer(&gl_state, GL_COPY_WRITE_BUFFER, buffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, size, data, GL_DYNAMIC_DRAW);
+        material->uniform_buffer = render_resource::create_handle(buffer);
+    }
+    else
+    {
+        gl_state_cache::bind_buffer(&gl_state, GL_COPY_WRITE_BUFFER, material->uniform_buffer.handle);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, 0, size, data);
+    }
+
+    material->uniform_buffer_dirty = false;
+}
+
+const void* automatic_uniform_value(const ViewUniforms* view_uniforms, uniform::AutomaticValue automatic_value)
+{
+    switch (automatic_value)
+    {
+    case uniform::ModelViewProjectionMatrix: return &view_uniforms->model_view_projection_matrix;
+    case uniform::ModelViewMatrix: return &view_uniforms->model_view_matrix;
+    case uniform::ModelMatrix: return &view_uniforms->model_matrix;
+    case uniform::Time: return &view_uniforms->time;
+    case uniform::ViewResolution: return &view_uniforms->view_resolution;
+    case uniform::ViewResolutionRatio: return &view_uniforms->view_resolution_ratio;
+    case uniform::Resolution: return &view_uniforms->resolution;
+    default: Error("Unknown automatic uniform value"); return nullptr;
+    }
+}
+
+void write_sprite_instances(SpriteInstance* instances, const RenderWorldSpriteData* sprites, uint32 start, uint32 num)
+{
+    for (uint32 i = start; i < start + num; ++i)
+    {
+        auto instance = instances + i - start;
+        memcpy(instance->corners, sprites->geometry + i, sizeof(Quad));
+        instance->color = pack_color(sprites->color + i);
+        instance->uv_rect[0] = 0;
+        instance->uv_rect[1] = 0;
+        instance->uv_rect[2] = 65535;
+        instance->uv_rect[3] = 65535;
+    }
+}
+
+// Keeps the world's GPU copy of the sprites up to date. Dirty blocks are written to the streaming vertex
+// buffer and copied from there, so the upload never waits for draws still reading the world's buffer.
+void upload_dirty_sprites(RenderWorld* rw)
+{
+    auto upload_all = false;
+
+    if (rw->gpu_sprites_capacity < rw->sprites_capacity)
+    {
+        if (rw->gpu_sprites.type != RenderResourceType::NotInitialized)
+            destroy_gpu_sprites(rw->gpu_sprites);
+
+        GLuint buffer;
+        glGenBuffers(1, &buffer);
+        gl_state_cache::bind_buffer(&gl_state, GL_COPY_WRITE_BUFFER, buffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, rw->sprites_capacity * sizeof(SpriteInstance), nullptr, GL_DYNAMIC_DRAW);
+        rw->gpu_sprites = render_resource::create_handle(buffer);
+        rw->gpu_sprites_capacity = rw->sprites_capacity;
+        upload_all = true;
+    }
+    else if (!rw->has_dirty_sprite_blocks)
+        return;
+
+    const auto block_size = render_world::sprite_block_size;
+    const uint32 max_blocks_per_upload = streaming_vertex_buffer_region_size / (sizeof(SpriteInstance) * block_size);
+    const auto num_blocks = (rw->num_sprites + block_size - 1) / block_size;
+    uint32 block = 0;
+
+    while (block < num_blocks)
+    {
+        if (!upload_all && rw->dirty_sprite_blocks[block] == 0)
+        {
+            ++block;
+            continue;
+        }
+
+        auto end_block = block + 1;
+
+        while (end_block < num_blocks && end_block - block < max_blocks_per_upload && (upload_all || rw->dirty_sprite_blocks[end_block] != 0))
+            ++end_block;
+
+        auto first = block * block_size;
+        auto end = end_block * block_size < rw->num_sprites ? end_block * block_size : rw->num_sprites;
+        auto size = (end - first) * sizeof(SpriteInstance);
+        uint32 offset;
+        auto instances = (SpriteInstance*)begin_streaming_vertices(&streaming_vertex_buffer, size, &offset);
+        write_sprite_instances(instances, &rw->sprites, first, end - first);
+        end_streaming_vertices(&streaming_vertex_buffer);
+        gl_state_cache::bind_buffer(&gl_state, GL_COPY_READ_BUFFER, streaming_vertex_buffer.buffer);
+        gl_state_cache::bind_buffer(&gl_state, GL_COPY_WRITE_BUFFER, rw->gpu_sprites.handle);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, offset, first * sizeof(SpriteInstance), size);
+        block = end_block;
+    }
+
+    render_world::clear_dirty_sprites(rw);
+}
+
+void draw_batch(uint32 start, uint32 size, const RenderWorldSpriteData* sprites, GLuint gpu_sprites, const ViewUniforms* view_uniforms, const RenderResourceTable* resource_table)
 {
-    auto model_view_projection_matrix = view_projection_matrix;
-    auto model_view_matrix = view_matrix;
-    auto material = (RenderMaterial*)render_resource_table::lookup(resource_table, components[start]->material).object;
+    auto material = (RenderMaterial*)render_resource_table::lookup(resource_table, sprites->material[start]).object;
     auto shader = render_resource_table::lookup(resource_table, material->shader).handle;
-    Assert(glIsProgram(shader), "Invalid shader program");
-    glUseProgram(shader);
-    auto view_resolution_ratio = view->size.y / resolution->y;
-    auto resoultion_real32 = vector2::create((real32)resolution->x, (real32)resolution->y);
-    auto ident = matrix4::indentity();
+    Assert(shader != 0, "Invalid shader program");
+    gl_state_cache::use_program(&gl_state, shader);
+
+    if (material->uniform_buffer_size > 0)
+    {
+        if (material->uniform_buffer_dirty)
+            upload_material_uniforms(material);
+
+        gl_state_cache::bind_uniform_buffer(&gl_state, material_uniforms_binding, material->uniform_buffer.handle);
+    }
 
     auto uniforms = material->uniforms;
     for (uint32 i = 0; i < material->num_uniforms; ++i)
     {
         auto uniform = uniforms + i;
-        auto value = (void*)uniform->value;
 
-        switch (uniform->automatic_value)
-        {
-        case uniform::ModelViewProjectionMatrix:
-            value = (void*)&model_view_projection_matrix->x.x;
-            break;
-        case uniform::ModelViewMatrix:
-            value = (void*)&model_view_matrix->x.x;
-            break;
-        case uniform::ModelMatrix:
-            value = (void*)&ident.x.x;
-            break;
-        case uniform::Time:
-            value = &time;
-            break;
-        case uniform::ViewResolution:
-            value = (void*)&view->size;
-            break;
-        case uniform::ViewResolutionRatio:
-            value = (void*)&view_resolution_ratio;
-            break;
-        case uniform::Resolution:
-            value = (void*)&resoultion_real32;
-            break;
-        }
+        // Uniforms in the view or material uniform blocks have no location.
+        if (uniform->location == -1 || uniform->buffer_offset != render_uniform::not_in_buffer)
+            continue;
 
-        switch (uniform->type)
+        if (uniform->type == uniform::Texture1)
         {
-        case uniform::Float: glUniform1fv(uniform->location, 1, (GLfloat*)value); break;
-        case uniform::Vec2: glUniform2fv(uniform->location, 1, (GLfloat*)value); break;
-        case uniform::Vec3: glUniform3fv(uniform->location, 1, (GLfloat*)value); break;
-        case uniform::Vec4: glUniform4fv(uniform->location, 1, (GLfloat*)value); break;
-        case uniform::Mat3: glUniformMatrix3fv(uniform->location, 1, GL_FALSE, (GLfloat*)value); break;
-        case uniform::Mat4: glUniformMatrix4fv(uniform->location, 1, GL_FALSE, (GLfloat*)value); break;
-        case uniform::Texture1:
-        {
-            if (uniform->location == -1)
-                break;
-
-            glActiveTexture(GL_TEXTURE0);
-            auto texture_handle = *(RenderResourceHandle*)value;
+            auto texture_handle = *(RenderResourceHandle*)uniform->value;
             auto texture = *(RenderTexture*)render_resource_table::lookup(resource_table, texture_handle).object;
-            glBindTexture(GL_TEXTURE_2D, value == nullptr ? 0 : texture.render_handle.handle);
-            glUniform1i(uniform->location, 0);
-        } break;
-        default:
-            Error("Unknown uniform type");
+            gl_state_cache::bind_texture(&gl_state, 0, texture.render_handle.handle);
+            uint32 texture_unit = 0;
+            gl_state_cache::set_uniform(&gl_state, uniform->location, uniform->type, &texture_unit);
+            continue;
         }
-    }
 
-    static const uint32 draw_buffer_size = 864000;
-    static real32 draw_buffer[draw_buffer_size];
-    const uint32 rect_buffer_num_elements = 54;
-    const uint32 rect_buffer_size = rect_buffer_num_elements * sizeof(real32);
-    const uint32 total_buffer_size = rect_buffer_size * size;
-    Assert(total_buffer_size <= draw_buffer_size, "Draw buffer size exceeded limit. Increase in opengl_renderer.cpp");
+        auto value = uniform->automatic_value == uniform::None
+            ? (const void*)uniform->value
+            : automatic_uniform_value(view_uniforms, uniform->automatic_value);
 
-    for (uint32 i = start; i < start + size; ++i)
-    {
-        real32* current_buffer = draw_buffer + rect_buffer_num_elements * (i - start);
-        auto v1 = &components[i]->geometry.v1;
-        auto v2 = &components[i]->geometry.v2;
-        auto v3 = &components[i]->geometry.v3;
-        auto v4 = &components[i]->geometry.v4;
-
-        auto r = (real32)components[i]->color.r;
-        auto g = (real32)components[i]->color.g;
-        auto b = (real32)components[i]->color.b;
-        auto a = (real32)components[i]->color.a;
-
-        real32 current_buffer_data[rect_buffer_num_elements] = {
-            v1->x, v1->y, 0.0f,
-            0.0f, 0.0f,
-            r, g, b, a,
-            v2->x, v2->y, 0.0f,
-            1.0f, 0.0f,
-            r, g, b, a,
-            v3->x, v3->y, 0.0f,
-            0.0f, 1.0f,
-            r, g, b, a,
-
-            v2->x, v2->y, 0.0f,
-            1.0f, 0.0f,
-            r, g, b, a,
-            v4->x, v4->y, 0.0f,
-            1.0f, 1.0f,
-            r, g, b, a,
-            v3->x, v3->y, 0.0f,
-            0.0f, 1.0f,
-            r, g, b, a
-        };
-
-        memcpy(current_buffer, &current_buffer_data, rect_buffer_size);
+        gl_state_cache::set_uniform(&gl_state, uniform->location, uniform->type, value);
     }
 
-    auto geometry = create_geometry_internal(draw_buffer, total_buffer_size);
-
-    glBindBuffer(GL_ARRAY_BUFFER, geometry);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(
-        0,
-        3,
-        GL_FLOAT,
-        GL_FALSE,
-        9 * sizeof(real32),
-        (void*)0
-        );
-
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(
-        1,
-        2,
-        GL_FLOAT,
-        GL_FALSE,
-        9 * sizeof(real32),
-        (void*)(3 * sizeof(real32))
-        );
-
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(
-        2,
-        3,
-        GL_FLOAT,
-        GL_FALSE,
-        9 * sizeof(real32),
-        (void*)(5 * sizeof(real32))
-        );
-
-    glDrawArrays(GL_TRIANGLES, 0, 6 * size);
-    glDisableVertexAttribArray(0);
-
-    destroy_geometry_internal(geometry);
-}
-
-void draw(const Rect* view, const RenderWorld* render_world, const Vector2u* resolution, real32 time, const RenderResource* resource_table)
-{
-    if (render_world->components.size == 0)
+    // With base instance support the attribute pointers stay the same for all batches of a world.
+    auto base_instance = glDrawArraysInstancedBaseInstance != nullptr;
+    auto offset = base_instance ? 0 : start * sizeof(SpriteInstance);
+    auto stride = sizeof(SpriteInstance);
+    gl_state_cache::enable_vertex_attributes(&gl_state, 0x1f);
+    gl_state_cache::vertex_attribute(&gl_state, 0, unit_quad, 2, GL_FLOAT, GL_FALSE, 0, 0);
+    gl_state_cache::vertex_attribute(&gl_state, 1, gpu_sprites, 4, GL_FLOAT, GL_FALSE, stride, offset + offsetof(SpriteInstance, corners));
+    gl_state_cache::vertex_attribute(&gl_state, 2, gpu_sprites, 4, GL_FLOAT, GL_FALSE, stride, offset + offsetof(SpriteInstance, corners) + 4 * sizeof(real32));
+    gl_state_cache::vertex_attribute(&gl_state, 3, gpu_sprites, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, offset + offsetof(SpriteInstance, color));
+    gl_state_cache::vertex_attribute(&gl_state, 4, gpu_sprites, 4, GL_UNSIGNED_SHORT, GL_TRUE, stride, offset + offsetof(SpriteInstance, uv_rect));
+
+    if (base_instance)
+        glDrawArraysInstancedBaseInstance(GL_TRIANGLE_STRIP, 0, 4, size, start);
+    else
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, size);
+}
+
+void draw(const Rect* view, RenderWorld* render_world, const Vector2u* resolution, real32 time, const RenderResourceTable* resource_table)
+{
+    if (render_world->num_sprites == 0)
         return;
 
-    auto view_matrix = view::view_matrix(view);
-    auto view_projection_matrix = matrix4::mul(&view_matrix, &view::projection_matrix(view));
-    uint32 num_components = render_world->components.size;
-    auto batch_material = render_world->components[0]->material;
-    auto batch_depth = render_world->components[0]->depth;
+    upload_dirty_sprites(render_world);
+    auto gpu_sprites = render_world->gpu_sprites.handle;
+
+    ViewUniforms view_uniforms = {};
+    view_uniforms.model_view_matrix = view::view_matrix(view);
+    view_uniforms.model_view_projection_matrix = matrix4::mul(&view_uniforms.model_view_matrix, &view::projection_matrix(view));
+    view_uniforms.model_matrix = matrix4::indentity();
+    view_uniforms.view_resolution = view->size;
+    view_uniforms.resolution = vector2::create((real32)resolution->x, (real32)resolution->y);
+    view_uniforms.time = time;
+    view_uniforms.view_resolution_ratio = view->size.y / resolution->y;
+    gl_state_cache::bind_buffer(&gl_state, GL_COPY_WRITE_BUFFER, view_uniform_buffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, 0, sizeof(ViewUniforms), &view_uniforms);
+
+    auto sprites = &render_world->sprites;
+    uint32 num_sprites = render_world->num_sprites;
+    auto batch_material = sprites->material[0];
+    auto batch_depth = sprites->depth[0];
     uint32 batch_start = 0;    
 
-    for (uint32 i = 0; i < num_components; ++i)
+    for (uint32 i = 0; i < num_sprites; ++i)
     {
-        auto material = render_world->components[i]->material;
-        auto depth = render_world->components[i]->depth;
+        auto material = sprites->material[i];
+        auto depth = sprites->depth[i];
 
         if (batch_material == material && batch_depth == depth)
             continue;
 
-        draw_batch(batch_start, i - batch_start, render_world->components.data, resolution, view, &view_matrix, &view_projection_matrix, time, resource_table);
+        draw_batch(batch_start, i - batch_start, sprites, gpu_sprites, &view_uniforms, resource_table);
         batch_start = i;
         batch_material = material;
         batch_depth = depth;
     }
 
     // Draw last batch.
-    draw_batch(batch_start, num_components - batch_start, render_world->components.data, resolution, view, &view_matrix, &view_projection_matrix, time, resource_table);
+    draw_batch(batch_start, num_sprites - batch_start, sprites, gpu_sprites, &view_uniforms, resource_table);
 }
 
 uint32 get_uniform_location(RenderResource shader, const char* name)
@@ -423,6 +610,52 @@ uint32 get_uniform_location(RenderResource shader, const char* name)
     return glGetUniformLocation(shader.handle, name);
 }
 
+uint32 get_material_uniform_buffer_size(RenderResource shader)
+{
+    auto block_index = glGetUniformBlockIndex(shader.handle, "material_uniforms");
+
+    if (block_index == GL_INVALID_INDEX)
+        return 0;
+
+    GLint size;
+    glGetActiveUniformBlockiv(shader.handle, block_index, GL_UNIFORM_BLOCK_DATA_SIZE, &size);
+    return size;
+}
+
+uint32 get_material_uniform_buffer_offset(RenderResource shader, const char* name)
+{
+    auto block_index = glGetUniformBlockIndex(shader.handle, "material_uniforms");
+
+    if (block_index == GL_INVALID_INDEX)
+        return render_uniform::not_in_buffer;
+
+    GLuint uniform_index;
+    glGetUniformIndices(shader.handle, 1, &name, &uniform_index);
+
+    if (uniform_index == GL_INVALID_INDEX)
+        return render_uniform::not_in_buffer;
+
+    GLint uniform_block_index;
+    glGetActiveUniformsiv(shader.handle, 1, &uniform_index, GL_UNIFORM_BLOCK_INDEX, &uniform_block_index);
+
+    if ((GLuint)uniform_block_index != block_index)
+        return render_uniform::not_in_buffer;
+
+    // Material uniforms are packed as their plain values, which doesn't match the std140 layout of matrices.
+    GLint matrix_stride;
+    glGetActiveUniformsiv(shader.handle, 1, &uniform_index, GL_UNIFORM_MATRIX_STRIDE, &matrix_stride);
+
+    if (matrix_stride != 0)
+    {
+        Error("Matrix uniforms aren't supported in the material_uniforms block");
+        return render_uniform::not_in_buffer;
+    }
+
+    GLint offset;
+    glGetActiveUniformsiv(shader.handle, 1, &uniform_index, GL_UNIFORM_OFFSET, &offset);
+    return offset;
+}
+
 void initialize()
 {
     int extension_load_error = gl3wInit();
@@ -432,9 +665,39 @@ void initialize()
     glGenVertexArrays(1, &vao);
     glBindVertexArray(vao);
 
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    gl_state_cache::init(&gl_state);
+    gl_state_cache::set_blend(&gl_state, true, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     glDisable(GL_DEPTH_TEST);
+
+    static const real32 fullscreen_quad_data[] = {
+        -1.0f, -1.0f, 0.0f,
+        1.0f, -1.0f, 0.0f,
+        -1.0f, 1.0f, 0.0f,
+        -1.0f, 1.0f, 0.0f,
+        1.0f, -1.0f, 0.0f,
+        1.0f, 1.0f, 0.0f,
+    };
+
+    fullscreen_quad = create_geometry_internal((void*)fullscreen_quad_data, sizeof(fullscreen_quad_data));
+
+    static const real32 unit_quad_data[] = {
+        0.0f, 0.0f,
+        1.0f, 0.0f,
+        0.0f, 1.0f,
+        1.0f, 1.0f
+    };
+
+    unit_quad = create_geometry_internal((void*)unit_quad_data, sizeof(unit_quad_data));
+
+    for (uint32 i = 1; i < 5; ++i)
+        glVertexAttribDivisor(i, 1);
+
+    init_streaming_vertex_buffer(&streaming_vertex_buffer);
+
+    glGenBuffers(1, &view_uniform_buffer);
+    gl_state_cache::bind_buffer(&gl_state, GL_COPY_WRITE_BUFFER, view_uniform_buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, sizeof(ViewUniforms), nullptr, GL_DYNAMIC_DRAW);
+    gl_state_cache::bind_uniform_buffer(&gl_state, view_uniforms_binding, view_uniform_buffer);
 }
 
 void resize(const Vector2u* resolution, RenderTarget* render_targets)
@@ -464,6 +727,7 @@ void set_render_target(const Vector2u* resolution, RenderResource render_target)
 
 void destroy_shader(RenderResource handle)
 {
+    gl_state_cache::forget_program(&gl_state, handle.handle);
     glDeleteProgram(handle.handle);
 }
 
@@ -474,6 +738,7 @@ void unset_render_target(const Vector2u* resolution)
 
 RenderResource update_shader(const RenderResource* shader, const char* vertex_source, const char* fragment_source)
 {
+    gl_state_cache::forget_program(&gl_state, shader->handle);
     glDeleteProgram(shader->handle);
     return RenderResource(create_shader(vertex_source, fragment_source));
 }
@@ -492,15 +757,20 @@ ConcreteRenderer create()
     renderer.create_shader = &create_shader;
     renderer.create_texture = &create_texture;
     renderer.destroy_texture = &destroy_texture;
+    renderer.destroy_gpu_sprites = &destroy_gpu_sprites;
     renderer.destroy_render_target = &destroy_render_target;
     renderer.destroy_shader = &destroy_shader;
     renderer.draw = &draw;
     renderer.get_uniform_location = &get_uniform_location;
+    renderer.get_material_uniform_buffer_size = &get_material_uniform_buffer_size;
+    renderer.get_material_uniform_buffer_offset = &get_material_uniform_buffer_offset;
+    renderer.destroy_uniform_buffer = &destroy_uniform_buffer;
     renderer.initialize = &initialize;
     renderer.resize = &resize;
     renderer.set_render_target = &set_render_target;
     renderer.unset_render_target = &unset_render_target;
     renderer.update_shader = &update_shader;
+    renderer.state_change_stats = &state_change_stats;
     return renderer;
 }
 
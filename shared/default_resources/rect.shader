@@ -1,17 +1,32 @@
 #version 410 core
 
-layout(location = 0) in vec3 in_position;
-layout(location = 1) in vec2 in_texcoord;
-layout(location = 2) in vec4 in_color;
+// Instanced, see SpriteInstance in opengl_renderer.cpp. Draws a unit quad mapped onto the sprite's corners.
+layout(location = 0) in vec2 in_corner;
+layout(location = 1) in vec4 in_top_corners;
+layout(location = 2) in vec4 in_bottom_corners;
+layout(location = 3) in vec4 in_color;
+layout(location = 4) in vec4 in_uv_rect;
 out vec2 texcoord;
 out vec4 vertex_color;
 
-uniform mat4 model_view_projection_matrix;
+// Written once per view by the renderer, see ViewUniforms in opengl_renderer.cpp.
+layout(std140) uniform view_uniforms
+{
+    mat4 model_view_projection_matrix;
+    mat4 model_view_matrix;
+    mat4 model_matrix;
+    vec2 view_resolution;
+    vec2 resolution;
+    float time;
+    float view_resolution_ratio;
+};
 
 void main()
 {
-    vec4 position4 = vec4(in_position, 1);
-    texcoord = in_texcoord;
+    vec2 top = mix(in_top_corners.xy, in_top_corners.zw, in_corner.x);
+    vec2 bottom = mix(in_bottom_corners.xy, in_bottom_corners.zw, in_corner.x);
+    vec4 position4 = vec4(mix(top, bottom, in_corner.y), 0, 1);
+    texcoord = in_uv_rect.xy + in_corner * in_uv_rect.zw;
     vertex_color = in_color;
     gl_Position = model_view_projection_matrix * position4;
 }
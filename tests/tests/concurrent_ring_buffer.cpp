@@ -42,6 +42,23 @@ void writer(ConcurrentRingBuffer* b)
     }
 }
 
+void batch_writer(ConcurrentRingBuffer* b)
+{
+    auto i = 0;
+    Haze hs[3] = { { 1, 3 }, { 1, 5 }, { 1, 7 } };
+
+    while (i < 200000)
+    {
+        auto n = (uint32)(rand() % 3) + 1;
+
+        if (!concurrent_ring_buffer::fits_n(b, n))
+            continue;
+
+        concurrent_ring_buffer::write_n(b, hs, n);
+        i += n;
+    }
+}
+
 void consumer(ConcurrentRingBuffer* b)
 {
     auto i = 0;
@@ -60,6 +77,26 @@ void consumer(ConcurrentRingBuffer* b)
     }
 }
 
+void batch_consumer(ConcurrentRingBuffer* b)
+{
+    auto i = 0;
+
+    while (i < 200000)
+    {
+        auto span = concurrent_ring_buffer::peek_span(b);
+
+        for (uint32 j = 0; j < span.size; ++j)
+        {
+            auto h = (Haze*)span.data + j;
+            assert(h->lax == 1);
+            assert(h->bulgur == 3 || h->bulgur == 5 || h->bulgur == 7);
+        }
+
+        concurrent_ring_buffer::consume_n(b, span.size);
+        i += span.size;
+    }
+}
+
 void test_concurrent_ring_buffer(Allocator* allocator)
 {
     ConcurrentRingBuffer b;
@@ -69,6 +106,14 @@ void test_concurrent_ring_buffer(Allocator* allocator)
     w.join();
     c.join();
     concurrent_ring_buffer::deinit(&b);
+
+    ConcurrentRingBuffer bb;
+    concurrent_ring_buffer::init(&bb, allocator, 8, sizeof(Haze));
+    std::thread bw(&batch_writer, &bb);
+    std::thread bc(&batch_consumer, &bb);
+    bw.join();
+    bc.join();
+    concurrent_ring_buffer::deinit(&bb);
 }
 
 }
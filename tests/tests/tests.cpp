@@ -16,10 +16,11 @@ void test_temp_memory()
 {
     for (unsigned i = 0; i < 20000; ++i)
     {
-        temp_memory::new_frame();
+        auto frame = temp_memory::new_frame();
         single_temp_alloc();
         single_temp_alloc();
         single_temp_alloc();
+        temp_memory::retire_frame(frame);
     }
 }
 
@@ -31,8 +32,21 @@ int WINAPI WinMain(__in HINSTANCE, __in_opt HINSTANCE, __in_opt LPSTR, __in int)
     {
         const auto temp_memory_size = 256u;
         void* temp_memory_buffer = VirtualAlloc(0, temp_memory_size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
-        temp_memory::init(temp_memory_buffer, temp_memory_size);
+        temp_memory::init(temp_memory_buffer, temp_memory_size, 0);
+        temp_memory::init_thread(temp_memory_size);
         test_temp_memory();
         VirtualFree(temp_memory_buffer, 0, MEM_RELEASE);
     }
+
+    {
+        // Ring buffers are allocated from render thread memory.
+        const auto render_thread_memory_size = 65536u;
+        memory::init_reserved(&RenderThreadMemory, render_thread_memory_size, PageSize::Normal);
+        auto callstack_capturer = windows::callstack_capturer::create();
+        MallocAllocator allocator;
+        malloc_allocator::init(&allocator, "test allocator", &callstack_capturer);
+        tests::test_concurrent_ring_buffer(&allocator);
+        malloc_allocator::deinit(&allocator);
+        memory::deinit(&RenderThreadMemory);
+    }
 }